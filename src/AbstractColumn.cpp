@@ -20,6 +20,9 @@
 
 #include <QVariant>
 
+#include "DataRole.h"
+#include "Unit.h"
+
 AbstractColumn::AbstractColumn(QObject *parent):
 	QObject(parent)
 {
@@ -34,7 +37,12 @@ int AbstractColumn::count() const
 	return 1;
 }
 
-QVariant AbstractColumn::groupData(int, GroupBy::Group, std::span<const Unit *>, int) const
+unsigned AbstractColumn::unitDependencies() const
+{
+	return Unit::AllChanged;
+}
+
+QVariant AbstractColumn::groupData(int, GroupBy::Group, std::span<const Unit *>, const GroupAggregate &, int) const
 {
 	return {};
 }
@@ -62,11 +70,53 @@ Qt::ItemFlags AbstractColumn::unitFlags(int, const Unit &) const
 	return Qt::ItemIsEnabled;
 }
 
-Qt::ItemFlags AbstractColumn::groupFlags(int, std::span<const Unit *>) const
+Qt::ItemFlags AbstractColumn::groupFlags(int, std::span<const Unit *>, const GroupAggregate &) const
 {
 	return Qt::ItemIsEnabled;
 }
 
+AbstractColumn::CellState AbstractColumn::cellState(int section, const Unit &unit) const
+{
+	CellState state;
+	state.text = unitData(section, unit, Qt::DisplayRole).toString();
+	if (auto rating = unitData(section, unit, DataRole::RatingRole); !rating.isNull())
+		state.rating = rating.toDouble();
+	if (auto check = unitData(section, unit, Qt::CheckStateRole); !check.isNull())
+		state.check = check.value<Qt::CheckState>();
+	state.background = unitData(section, unit, Qt::BackgroundRole).value<QBrush>();
+	state.border = unitData(section, unit, DataRole::BorderRole).value<QBrush>();
+	state.flags = unitFlags(section, unit);
+	return state;
+}
+
+AbstractColumn::CellState AbstractColumn::groupCellState(int section, GroupBy::Group group, std::span<const Unit *> units, const GroupAggregate &aggregate) const
+{
+	CellState state;
+	state.text = groupData(section, group, units, aggregate, Qt::DisplayRole).toString();
+	if (auto rating = groupData(section, group, units, aggregate, DataRole::RatingRole); !rating.isNull())
+		state.rating = rating.toDouble();
+	if (auto check = groupData(section, group, units, aggregate, Qt::CheckStateRole); !check.isNull())
+		state.check = check.value<Qt::CheckState>();
+	state.background = groupData(section, group, units, aggregate, Qt::BackgroundRole).value<QBrush>();
+	state.border = groupData(section, group, units, aggregate, DataRole::BorderRole).value<QBrush>();
+	state.flags = groupFlags(section, units, aggregate);
+	return state;
+}
+
+std::optional<qint64> AbstractColumn::sortKey(int section, const Unit &unit) const
+{
+	auto value = unitData(section, unit, DataRole::SortRole);
+	switch (value.typeId()) {
+	case QMetaType::Bool:
+	case QMetaType::Int:
+	case QMetaType::UInt:
+	case QMetaType::LongLong:
+		return value.toLongLong();
+	default:
+		return std::nullopt;
+	}
+}
+
 void AbstractColumn::makeUnitMenu(int, Unit &, QMenu *, QWidget *)
 {
 }
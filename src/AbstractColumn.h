@@ -20,6 +20,9 @@
 #define ABSTRACT_COLUMN_H
 
 #include <QObject>
+#include <QBrush>
+
+#include <optional>
 
 #include "GroupBy.h"
 
@@ -34,15 +37,52 @@ public:
 	AbstractColumn(QObject *parent = nullptr);
 	~AbstractColumn() override;
 
+	// Counts of unit cell states in a group, maintained by GridViewModel
+	// from unitData(CheckStateRole) and unitFlags.
+	struct GroupAggregate {
+		int checked = 0; // units with a checked cell
+		int checkable = 0; // units with a user checkable cell
+
+		Qt::CheckState checkState(std::size_t unit_count) const {
+			return checked == 0
+				? Qt::Unchecked
+				: std::size_t(checked) == unit_count
+					? Qt::Checked
+					: Qt::PartiallyChecked;
+		}
+	};
+
+	// Typed state of a unit cell used for painting, it gathers the
+	// Display, Rating, CheckState, Background and Border roles and the
+	// item flags in a single call.
+	struct CellState {
+		QString text;
+		std::optional<double> rating;
+		std::optional<Qt::CheckState> check;
+		QBrush background;
+		QBrush border;
+		Qt::ItemFlags flags;
+	};
+
 	virtual int count() const;
+	// Unit::Change flags that may affect the unit cells, all by default
+	virtual unsigned unitDependencies() const;
 	virtual QVariant headerData(int section, int role = Qt::DisplayRole) const = 0;
 	virtual QVariant unitData(int section, const Unit &unit, int role = Qt::DisplayRole) const = 0;
-	virtual QVariant groupData(int section, GroupBy::Group group, std::span<const Unit *> units, int role = Qt::DisplayRole) const;
+	virtual QVariant groupData(int section, GroupBy::Group group, std::span<const Unit *> units, const GroupAggregate &aggregate, int role = Qt::DisplayRole) const;
 	virtual bool setUnitData(int section, Unit &unit, const QVariant &value, int role = Qt::EditRole);
 	virtual bool setGroupData(int section, std::span<Unit *> units, const QVariant &value, int role = Qt::EditRole);
 	virtual void toggleUnits(int section, std::span<Unit *> units);
 	virtual Qt::ItemFlags unitFlags(int section, const Unit &unit) const;
-	virtual Qt::ItemFlags groupFlags(int section, std::span<const Unit *> units) const;
+	virtual Qt::ItemFlags groupFlags(int section, std::span<const Unit *> units, const GroupAggregate &aggregate) const;
+	// Default implementation is built from unitData and unitFlags
+	virtual CellState cellState(int section, const Unit &unit) const;
+	// Built from groupData and groupFlags
+	CellState groupCellState(int section, GroupBy::Group group, std::span<const Unit *> units, const GroupAggregate &aggregate) const;
+	// Integer key equivalent to unitData(SortRole), or nullopt if the sort
+	// value is not integral and must be compared as a QVariant. Default
+	// implementation converts integral SortRole values.
+	virtual std::optional<qint64> sortKey(int section, const Unit &unit) const;
 
 	virtual void makeUnitMenu(int section, Unit &unit, QMenu *menu, QWidget *parent);
 	virtual void makeHeaderMenu(int section, QMenu *menu, QWidget *parent);
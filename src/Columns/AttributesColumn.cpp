@@ -49,6 +49,11 @@ int AttributesColumn::count() const
 	return _attrs.size();
 }
 
+unsigned AttributesColumn::unitDependencies() const
+{
+	return Unit::AttributesChanged | Unit::OtherChanged;
+}
+
 QVariant AttributesColumn::headerData(int section, int role) const
 {
 	switch (role) {
@@ -106,6 +111,14 @@ QVariant AttributesColumn::unitData(int section, const Unit &unit, int role) con
 	}
 }
 
+std::optional<qint64> AttributesColumn::sortKey(int section, const Unit &unit) const
+{
+	const auto &attr = _attrs.at(section);
+	if (!unit.attribute(attr))
+		return std::nullopt;
+	return unit.attributeValue(attr);
+}
+
 Factory AttributesColumn::makeFactory(const QJsonObject &json)
 {
 	std::vector<Unit::attribute_t> attrs;
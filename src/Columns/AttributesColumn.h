@@ -33,8 +33,10 @@ public:
 	~AttributesColumn() override;
 
 	int count() const override;
+	unsigned unitDependencies() const override;
 	QVariant headerData(int section, int role = Qt::DisplayRole) const override;
 	QVariant unitData(int section, const Unit &unit, int role = Qt::DisplayRole) const override;
+	std::optional<qint64> sortKey(int section, const Unit &unit) const override;
 
 	static Factory makeFactory(const QJsonObject &);
 
@@ -27,6 +27,7 @@
 #include "UnitFlagsColumn.h"
 #include "AttributesColumn.h"
 #include "SkillsColumn.h"
+#include "ScriptColumn.h"
 
 Columns::Factory Columns::makeFactory(const QJsonObject &col)
 {
@@ -39,6 +40,8 @@ Columns::Factory Columns::makeFactory(const QJsonObject &col)
 		return AttributesColumn::makeFactory(col);
 	else if (type == "Skills")
 		return SkillsColumn::makeFactory(col);
+	else if (type == "Script")
+		return ScriptColumn::makeFactory(col);
 	else {
 		qCCritical(GridViewLog) << "Unsupported column type:" << type;
 		return {};
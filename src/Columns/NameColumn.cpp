@@ -40,6 +40,11 @@ NameColumn::~NameColumn()
 {
 }
 
+unsigned NameColumn::unitDependencies() const
+{
+	return Unit::NameChanged | Unit::OtherChanged;
+}
+
 QVariant NameColumn::headerData(int section, int role) const
 {
 	switch (role) {
@@ -69,7 +74,18 @@ QVariant NameColumn::unitData(int section, const Unit &unit, int role) const
 	}
 }
 
-QVariant NameColumn::groupData(int section, GroupBy::Group group, std::span<const Unit *> units, int role) const
+std::optional<qint64> NameColumn::sortKey(int, const Unit &unit) const
+{
+	switch (_sort.option) {
+	case SortBy::Name: // compared as strings
+		return std::nullopt;
+	case SortBy::Age:
+		return unit.age().count();
+	}
+	return std::nullopt;
+}
+
+QVariant NameColumn::groupData(int section, GroupBy::Group group, std::span<const Unit *> units, const GroupAggregate &aggregate, int role) const
 {
 	switch (role) {
 	case Qt::DisplayRole:
@@ -94,7 +110,7 @@ Qt::ItemFlags NameColumn::unitFlags(int section, const Unit &unit) const
 	return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsEditable;
 }
 
-Qt::ItemFlags NameColumn::groupFlags(int section, std::span<const Unit *> units) const
+Qt::ItemFlags NameColumn::groupFlags(int section, std::span<const Unit *> units, const GroupAggregate &aggregate) const
 {
 	return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
 }
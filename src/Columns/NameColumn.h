@@ -32,11 +32,13 @@ public:
 	~NameColumn() override;
 
 	QVariant headerData(int section, int role = Qt::DisplayRole) const override;
+	unsigned unitDependencies() const override;
 	QVariant unitData(int section, const Unit &unit, int role = Qt::DisplayRole) const override;
-	QVariant groupData(int section, GroupBy::Group group, std::span<const Unit *> units, int role = Qt::DisplayRole) const override;
+	std::optional<qint64> sortKey(int section, const Unit &unit) const override;
+	QVariant groupData(int section, GroupBy::Group group, std::span<const Unit *> units, const GroupAggregate &aggregate, int role = Qt::DisplayRole) const override;
 	bool setUnitData(int section, Unit &unit, const QVariant &value, int role = Qt::EditRole) override;
 	Qt::ItemFlags unitFlags(int section, const Unit &unit) const override;
-	Qt::ItemFlags groupFlags(int section, std::span<const Unit *> units) const override;
+	Qt::ItemFlags groupFlags(int section, std::span<const Unit *> units, const GroupAggregate &aggregate) const override;
 
 	void makeHeaderMenu(int section, QMenu *menu, QWidget *parent) override;
 	void makeUnitMenu(int section, Unit &unit, QMenu *menu, QWidget *parent) override;
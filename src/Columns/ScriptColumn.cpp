@@ -0,0 +1,333 @@
+/*
+ * Copyright 2024 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "ScriptColumn.h"
+
+#include "Application.h"
+#include "DataRole.h"
+#include "DwarfFortressData.h"
+#include "LogCategory.h"
+#include "ObjectList.h"
+#include "ScriptManager.h"
+#include "Unit.h"
+
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QRegularExpression>
+#include <QTimer>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Columns;
+
+// Units computed in each background batch
+static constexpr std::size_t UpdateBatchSize = 256;
+
+ScriptColumn::ScriptColumn(std::span<const script_t> scripts, DwarfFortressData &df, QObject *parent):
+	AbstractColumn(parent),
+	_scripts(scripts.begin(), scripts.end()),
+	_failed(_scripts.size(), false),
+	_uses_units(false),
+	_df(df)
+{
+	_batch_pool.setMaxThreadCount(1);
+	connect(&_batch_watcher, &QFutureWatcherBase::finished,
+		this, &ScriptColumn::batchFinished);
+	static const QRegularExpression units_global("\\bunits\\b");
+	_uses_units = std::ranges::any_of(_scripts, [](const auto &script) {
+		return units_global.match(script.source).hasMatch();
+	});
+	auto units = _df.units.get();
+	connect(units, &ObjectListBase::aboutToUpdate,
+		this, &ScriptColumn::cancelBatch);
+	connect(units, &QAbstractItemModel::rowsInserted,
+		this, [this](const QModelIndex &, int first, int last) {
+			unitsChanged(first, last);
+		});
+	connect(units, &QAbstractItemModel::rowsAboutToBeRemoved,
+		this, [this](const QModelIndex &, int first, int last) {
+			unitsRemoved(first, last);
+		});
+	if (_uses_units)
+		connect(units, &QAbstractItemModel::rowsRemoved,
+			this, &ScriptColumn::allUnitsChanged);
+	connect(units, &QAbstractItemModel::dataChanged,
+		this, [this](const QModelIndex &first, const QModelIndex &last) {
+			unitsChanged(first.row(), last.row());
+		});
+	connect(units, &QAbstractItemModel::modelReset,
+		this, &ScriptColumn::reset);
+	reset();
+}
+
+ScriptColumn::~ScriptColumn()
+{
+	cancelBatch();
+}
+
+int ScriptColumn::count() const
+{
+	return _scripts.size();
+}
+
+unsigned ScriptColumn::unitDependencies() const
+{
+	// Cells only change when updateCells computes them
+	return 0;
+}
+
+QVariant ScriptColumn::headerData(int section, int role) const
+{
+	if (role != Qt::DisplayRole)
+		return {};
+	return _scripts.at(section).title;
+}
+
+QVariant ScriptColumn::unitData(int section, const Unit &unit, int role) const
+{
+	auto c = cell(section, unit);
+	if (!c)
+		return {};
+	switch (role) {
+	case Qt::DisplayRole:
+	case DataRole::SortRole:
+		return c->value;
+	case DataRole::RatingRole:
+		return c->rating ? QVariant(*c->rating) : QVariant();
+	default:
+		return {};
+	}
+}
+
+const ScriptColumn::cell_t *ScriptColumn::cell(int section, const Unit &unit) const
+{
+	auto it = _units.find(unit->id);
+	if (it == _units.end() || it->second.cells.empty())
+		return nullptr;
+	return &it->second.cells.at(section);
+}
+
+void ScriptColumn::unitsChanged(int first, int last)
+{
+	if (_uses_units) {
+		first = 0;
+		last = _df.units->rowCount()-1;
+	}
+	++_generation;
+	for (int row = first; row <= last; ++row) {
+		int id = (*_df.units->get(row))->id;
+		auto &entry = _units[id];
+		if (!entry.queued) {
+			_pending.push_back(id);
+			entry.queued = true;
+		}
+		entry.changed = _generation;
+	}
+	queueUpdate();
+}
+
+void ScriptColumn::unitsRemoved(int first, int last)
+{
+	// Pending ids of removed units are skipped by updateCells
+	for (int row = first; row <= last; ++row)
+		_units.erase((*_df.units->get(row))->id);
+}
+
+void ScriptColumn::allUnitsChanged()
+{
+	if (_df.units->rowCount() > 0)
+		unitsChanged(0, _df.units->rowCount()-1);
+}
+
+void ScriptColumn::reset()
+{
+	_units.clear();
+	_pending.clear();
+	allUnitsChanged();
+}
+
+void ScriptColumn::queueUpdate()
+{
+	// A running batch queues the next one when it returns
+	if (_update_queued || _batch || _scripts.empty())
+		return;
+	_update_queued = true;
+	QTimer::singleShot(0, this, &ScriptColumn::updateCells);
+}
+
+static bool isNumber(const QVariant &value)
+{
+	switch (value.typeId()) {
+	case QMetaType::Int:
+	case QMetaType::UInt:
+	case QMetaType::LongLong:
+	case QMetaType::ULongLong:
+	case QMetaType::Double:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static QVariant cellValue(const QVariant &value)
+{
+	if (value.typeId() == QMetaType::Bool || value.typeId() == QMetaType::QString)
+		return value;
+	if (isNumber(value)) {
+		// Keep integers integral for GridSortModel keys
+		double number = value.toDouble();
+		if (std::trunc(number) == number && std::abs(number) < 0x1p53)
+			return qint64(number);
+		return number;
+	}
+	return {};
+}
+
+void ScriptColumn::updateCells()
+{
+	_update_queued = false;
+	if (_batch)
+		return;
+	auto batch = std::make_shared<batch_t>();
+	while (!_pending.empty() && batch->units.size() < UpdateBatchSize) {
+		int id = _pending.front();
+		_pending.pop_front();
+		auto it = _units.find(id);
+		if (it == _units.end())
+			continue;
+		it->second.queued = false;
+		auto index = _df.units->find(id);
+		Q_ASSERT(index.isValid());
+		batch->ids.push_back(id);
+		batch->units.push_back(_df.units->get(index.row()));
+	}
+	if (batch->units.empty())
+		return;
+	batch->generation = _generation;
+	std::vector<QString> sources; // empty for disabled scripts
+	for (std::size_t section = 0; section < _scripts.size(); ++section)
+		sources.push_back(_failed[section] ? QString() : _scripts[section].source);
+	_batch = batch;
+	_batch_watcher.setFuture(QtConcurrent::run(&_batch_pool, [batch, sources = std::move(sources)]() {
+		batch_results_t results;
+		for (const auto &source: sources) {
+			if (source.isEmpty() || batch->cancelled)
+				results.emplace_back();
+			else
+				results.push_back(Application::scripts().mapUnits(source, batch->units));
+		}
+		return results;
+	}));
+}
+
+void ScriptColumn::batchFinished()
+{
+	auto batch = std::exchange(_batch, nullptr);
+	if (!batch)
+		return;
+	auto requeue = [this](int id, unit_cells_t &entry) {
+		if (!entry.queued) {
+			_pending.push_back(id);
+			entry.queued = true;
+		}
+	};
+	if (batch->cancelled) {
+		// The units may have been deleted, only the ids are valid
+		for (auto id: batch->ids)
+			if (auto it = _units.find(id); it != _units.end())
+				requeue(id, it->second);
+		if (!_pending.empty())
+			queueUpdate();
+		return;
+	}
+	auto results = _batch_watcher.result();
+	for (std::size_t section = 0; section < _scripts.size(); ++section) {
+		if (!results[section] && !_failed[section]) {
+			qCWarning(GridViewLog) << "Script column" << _scripts[section].title
+				<< "exceeded its time budget and is disabled";
+			_failed[section] = true;
+		}
+	}
+	std::vector<int> ids;
+	for (std::size_t i = 0; i < batch->ids.size(); ++i) {
+		auto it = _units.find(batch->ids[i]);
+		if (it == _units.end())
+			continue;
+		auto &entry = it->second;
+		entry.cells.resize(_scripts.size());
+		for (std::size_t section = 0; section < _scripts.size(); ++section) {
+			auto &cell = entry.cells[section];
+			if (!results[section]) {
+				cell = {};
+				continue;
+			}
+			const auto &result = (*results[section])[i];
+			if (result.typeId() == QMetaType::QVariantMap && result.toMap().contains("value")) {
+				auto object = result.toMap();
+				cell.value = cellValue(object["value"]);
+				auto rating = object["rating"];
+				cell.rating = isNumber(rating)
+					? std::optional(rating.toDouble())
+					: std::nullopt;
+			}
+			else {
+				cell.value = cellValue(result);
+				cell.rating.reset();
+			}
+		}
+		entry.generation = batch->generation;
+		// Changed again while the batch was running
+		if (entry.changed > entry.generation)
+			requeue(batch->ids[i], entry);
+		ids.push_back(batch->ids[i]);
+	}
+	if (!ids.empty())
+		unitDataChanged(0, count()-1, _df.units->makeSelection(ids));
+	if (!_pending.empty())
+		queueUpdate();
+}
+
+void ScriptColumn::cancelBatch()
+{
+	if (!_batch)
+		return;
+	_batch->cancelled = true;
+	_batch_watcher.waitForFinished();
+}
+
+Factory ScriptColumn::makeFactory(const QJsonObject &json)
+{
+	std::vector<script_t> scripts;
+	for (auto value: json["scripts"].toArray()) {
+		auto object = value.toObject();
+		auto title = object["title"].toString();
+		auto function = Application::scripts().makeFunction(object["script"].toString());
+		if (function.isError()) {
+			qCWarning(GridViewLog) << "Invalid script for Script column" << title
+				<< function.property("message").toString();
+			continue;
+		}
+		scripts.push_back({title, object["script"].toString()});
+	}
+	return [scripts = std::move(scripts)](DwarfFortressData &df) {
+		return std::make_unique<ScriptColumn>(scripts, df);
+	};
+}
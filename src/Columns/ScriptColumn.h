@@ -0,0 +1,125 @@
+/*
+ * Copyright 2024 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef COLUMNS_SCRIPT_COLUMN_H
+#define COLUMNS_SCRIPT_COLUMN_H
+
+#include "AbstractColumn.h"
+#include "Columns/Factory.h"
+
+#include <QFutureWatcher>
+#include <QThreadPool>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+
+class DwarfFortressData;
+
+namespace Columns {
+
+// Cells computed by a script function from the unit. The function returns
+// either a value or an object with value and rating (0 to 1) properties.
+//
+// Results are memoized for each unit refresh and computed in batches after
+// the units change, the JS engine is never called when painting. Batches
+// are run one at a time from a background thread in the worker thread
+// engines (see ScriptManager::mapUnits), a script exceeding the time
+// budget is disabled.
+//
+// Functions must only depend on their unit, unless they use the units
+// global: cells are then all computed again when any unit changes.
+class ScriptColumn: public AbstractColumn
+{
+	Q_OBJECT
+public:
+	struct script_t
+	{
+		QString title;
+		QString source; // validated with ScriptManager::makeFunction
+	};
+
+	ScriptColumn(std::span<const script_t> scripts, DwarfFortressData &df, QObject *parent = nullptr);
+	~ScriptColumn() override;
+
+	int count() const override;
+	unsigned unitDependencies() const override;
+	QVariant headerData(int section, int role = Qt::DisplayRole) const override;
+	QVariant unitData(int section, const Unit &unit, int role = Qt::DisplayRole) const override;
+
+	static Factory makeFactory(const QJsonObject &);
+
+private:
+	std::vector<script_t> _scripts;
+	std::vector<bool> _failed; // for each script
+	bool _uses_units; // any script uses the units global
+	DwarfFortressData &_df;
+
+	struct cell_t
+	{
+		QVariant value;
+		std::optional<double> rating;
+	};
+	struct unit_cells_t
+	{
+		quint64 generation = 0; // refresh generation of cells
+		quint64 changed = 0; // last refresh generation of the unit
+		bool queued = false; // in _pending
+		std::vector<cell_t> cells; // for each script
+	};
+	// Cells by unit id, units are queued in _pending when changed > generation
+	std::unordered_map<int, unit_cells_t> _units;
+	std::deque<int> _pending;
+	quint64 _generation = 0;
+	bool _update_queued = false;
+
+	// Batch computed in the background, results are for each script
+	// (std::nullopt if it is disabled) then for each unit.
+	using batch_results_t = std::vector<std::optional<std::vector<QVariant>>>;
+	struct batch_t
+	{
+		std::vector<int> ids;
+		std::vector<const Unit *> units;
+		quint64 generation;
+		std::atomic<bool> cancelled = false;
+	};
+	std::shared_ptr<batch_t> _batch;
+	// Batches wait for the script chunks run in the global pool, they
+	// use their own pool so they cannot starve it.
+	QThreadPool _batch_pool;
+	QFutureWatcher<batch_results_t> _batch_watcher;
+
+	const cell_t *cell(int section, const Unit &unit) const;
+	void unitsChanged(int first, int last);
+	void unitsRemoved(int first, int last);
+	void allUnitsChanged();
+	void reset();
+	void queueUpdate();
+	void updateCells();
+	void batchFinished();
+	// Cancel and wait for the running batch before the units are
+	// modified (ObjectListBase::aboutToUpdate), its units are queued
+	// again when it returns.
+	void cancelBatch();
+};
+
+}
+
+#endif
@@ -31,8 +31,9 @@
 
 using namespace Columns;
 
-SkillsColumn::SkillsColumn(std::span<const df::job_skill_t> skills, QObject *parent):
+SkillsColumn::SkillsColumn(std::span<const df::job_skill_t> skills, DwarfFortressData &df, QObject *parent):
 	AbstractColumn(parent),
+	_df(df),
 	_sort{*this, SortBy::Rating, {
 		{SortBy::Rating, tr("rating")},
 		{SortBy::RatingWithRust, tr("rating with rust")},
@@ -51,6 +52,11 @@ int SkillsColumn::count() const
 	return _skills.size();
 }
 
+unsigned SkillsColumn::unitDependencies() const
+{
+	return Unit::SkillsChanged;
+}
+
 QVariant SkillsColumn::headerData(int section, int role) const
 {
 	switch (role) {
@@ -61,63 +67,128 @@ QVariant SkillsColumn::headerData(int section, int role) const
 	}
 }
 
+static QColor rustColor(int rating, int rusty)
+{
+	df::unit_skill skill = {
+		.rating = static_cast<df::skill_rating_t>(rating),
+		.rusty = rusty,
+	};
+	switch (skill.rustLevel()) {
+	case df::unit_skill::Rusty:
+		return QColor(255, 128, 0);
+	case df::unit_skill::VeryRusty:
+		return QColor(255, 0, 0);
+	default:
+		return {};
+	}
+}
+
 QVariant SkillsColumn::unitData(int section, const Unit &unit, int role) const
 {
 	auto skill_id = _skills.at(section);
-	const df::unit_skill *skill = nullptr;
-	if (unit->current_soul)
-		skill = df::find(unit->current_soul->skills, skill_id);
+	auto row = unit.skillRow();
+	int rating = _df.skills.rating(row, skill_id);
+	if (rating < 0) // the unit does not have this skill
+		return role == DataRole::SortRole ? QVariant(-1) : QVariant();
 	switch (role) {
 	case Qt::DisplayRole:
-		if (skill)
-			return static_cast<int>(skill->rating);
-		return {};
+		return rating;
 	case DataRole::RatingRole:
-		if (skill)
-			return (1+skill->rating)/16.0;
-		return {};
-	case Qt::ToolTipRole:
-		if (skill) {
-			auto tooltip = QString("<h3>%1</h3>").arg(unit.displayName());
-			tooltip += tr("<p>%1 %2 (%3)</p>")
-				.arg(QString::fromLocal8Bit(caption(std::min(skill->rating, df::skill_rating::Legendary))))
-				.arg(QString::fromLocal8Bit(caption_noun(skill->id)))
-				.arg(static_cast<int>(skill->rating));
-			tooltip += tr("<p>Experience: %1/%2</p>")
-				.arg(skill->experience)
-				.arg(df::unit_skill::experience_for_next_level(skill->rating));
-			if (skill->rusty > 0)
-				tooltip += tr("<p>Rust: %1 (%2)</p>")
-					.arg(skill->rusty)
-					.arg(QString::fromLocal8Bit(caption(static_cast<df::skill_rating_t>(std::clamp(skill->rating-skill->rusty, 0, 15)))));
-			return tooltip;
-		}
-		return {};
-	case DataRole::BorderRole:
-		switch (skill ? skill->rustLevel() : df::unit_skill::NotRusty) {
-		case df::unit_skill::Rusty:
-			return QColor(255, 128, 0);
-		case df::unit_skill::VeryRusty:
-			return QColor(255, 0, 0);
-		default:
+		return (1+rating)/16.0;
+	case Qt::ToolTipRole: {
+		int rusty = _df.skills.rusty(row, skill_id);
+		auto tooltip = QString("<h3>%1</h3>").arg(unit.displayName());
+		tooltip += tr("<p>%1 %2 (%3)</p>")
+			.arg(QString::fromLocal8Bit(caption(static_cast<df::skill_rating_t>(std::min<int>(rating, df::skill_rating::Legendary)))))
+			.arg(QString::fromLocal8Bit(caption_noun(skill_id)))
+			.arg(rating);
+		tooltip += tr("<p>Experience: %1/%2</p>")
+			.arg(_df.skills.experience(row, skill_id))
+			.arg(df::unit_skill::experience_for_next_level(rating));
+		if (rusty > 0)
+			tooltip += tr("<p>Rust: %1 (%2)</p>")
+				.arg(rusty)
+				.arg(QString::fromLocal8Bit(caption(static_cast<df::skill_rating_t>(std::clamp(rating-rusty, 0, 15)))));
+		return tooltip;
+	}
+	case DataRole::BorderRole: {
+		auto color = rustColor(rating, _df.skills.rusty(row, skill_id));
+		if (color.isValid())
+			return color;
+		else
 			return {};
-		}
+	}
 	case DataRole::SortRole:
-		if (skill) switch (_sort.option) {
-			case SortBy::Rating:
-				return skill->rating;
-			case SortBy::RatingWithRust:
-				return std::max(skill->rating - skill->rusty, 0);
-			case SortBy::Experience:
-				return df::unit_skill::cumulated_experience(skill->rating) + skill->experience;
+		switch (_sort.option) {
+		case SortBy::Rating:
+			return rating;
+		case SortBy::RatingWithRust:
+			return _df.skills.ratingWithRust(row, skill_id);
+		case SortBy::Experience:
+			return _df.skills.totalExperience(row, skill_id);
 		}
-		else
-			return -1;
 	default:
 		return {};
 	}
 }
 
+AbstractColumn::CellState SkillsColumn::cellState(int section, const Unit &unit) const
+{
+	auto skill_id = _skills.at(section);
+	auto row = unit.skillRow();
+	CellState state = {.flags = unitFlags(section, unit)};
+	int rating = _df.skills.rating(row, skill_id);
+	if (rating < 0) // the unit does not have this skill
+		return state;
+	state.text = QString::number(rating);
+	state.rating = (1+rating)/16.0;
+	if (auto color = rustColor(rating, _df.skills.rusty(row, skill_id)); color.isValid())
+		state.border = color;
+	return state;
+}
+
+std::optional<qint64> SkillsColumn::sortKey(int section, const Unit &unit) const
+{
+	auto skill_id = _skills.at(section);
+	auto row = unit.skillRow();
+	int rating = _df.skills.rating(row, skill_id);
+	if (rating < 0)
+		return -1;
+	switch (_sort.option) {
+	case SortBy::Rating:
+		return rating;
+	case SortBy::RatingWithRust:
+		return _df.skills.ratingWithRust(row, skill_id);
+	case SortBy::Experience:
+		return _df.skills.totalExperience(row, skill_id);
+	default:
+		return std::nullopt;
+	}
+}
+
+QVariant SkillsColumn::groupData(int section, GroupBy::Group group, std::span<const Unit *> units, const GroupAggregate &aggregate, int role) const
+{
+	if (role != DataRole::SortRole)
+		return {};
+	auto skill_id = _skills.at(section);
+	int best = -1;
+	for (auto unit: units) {
+		auto row = unit->skillRow();
+		switch (_sort.option) {
+		case SortBy::Rating:
+			best = std::max(best, _df.skills.rating(row, skill_id));
+			break;
+		case SortBy::RatingWithRust:
+			best = std::max(best, _df.skills.ratingWithRust(row, skill_id));
+			break;
+		case SortBy::Experience:
+			best = std::max(best, _df.skills.totalExperience(row, skill_id));
+			break;
+		}
+	}
+	return best;
+}
+
 void SkillsColumn::makeHeaderMenu(int section, QMenu *menu, QWidget *parent)
 {
 	_sort.makeSortMenu(menu);
@@ -135,6 +206,6 @@ Factory SkillsColumn::makeFactory(const QJsonObject &json)
 			qCWarning(GridViewLog) << "Invalid skill value for Skills column" << skill_name;
 	}
 	return [skills = std::move(skills)](DwarfFortressData &df) {
-		return std::make_unique<SkillsColumn>(skills);
+		return std::make_unique<SkillsColumn>(skills, df);
 	};
 }
@@ -32,18 +32,23 @@ class SkillsColumn: public AbstractColumn
 {
 	Q_OBJECT
 public:
-	SkillsColumn(std::span<const df::job_skill_t> skills, QObject *parent = nullptr);
+	SkillsColumn(std::span<const df::job_skill_t> skills, DwarfFortressData &df, QObject *parent = nullptr);
 	~SkillsColumn() override;
 
 	int count() const override;
+	unsigned unitDependencies() const override;
 	QVariant headerData(int section, int role = Qt::DisplayRole) const override;
 	QVariant unitData(int section, const Unit &unit, int role = Qt::DisplayRole) const override;
+	QVariant groupData(int section, GroupBy::Group group, std::span<const Unit *> units, const GroupAggregate &aggregate, int role = Qt::DisplayRole) const override;
+	CellState cellState(int section, const Unit &unit) const override;
+	std::optional<qint64> sortKey(int section, const Unit &unit) const override;
 
 	void makeHeaderMenu(int section, QMenu *menu, QWidget *parent) override;
 
 	static Factory makeFactory(const QJsonObject &);
 
 private:
+	DwarfFortressData &_df;
 	std::vector<df::job_skill_t> _skills;
 	enum class SortBy {
 		Rating,
@@ -46,6 +46,11 @@ int UnitFlagsColumn::count() const
 	return _flags.size();
 }
 
+unsigned UnitFlagsColumn::unitDependencies() const
+{
+	return Unit::FlagsChanged | Unit::OtherChanged;
+}
+
 QVariant UnitFlagsColumn::headerData(int section, int role) const
 {
 	if (role != Qt::DisplayRole)
@@ -66,22 +71,31 @@ QVariant UnitFlagsColumn::unitData(int section, const Unit &unit, int role) cons
 	}
 }
 
-QVariant UnitFlagsColumn::groupData(int section, GroupBy::Group group, std::span<const Unit *> units, int role) const
+AbstractColumn::CellState UnitFlagsColumn::cellState(int section, const Unit &unit) const
+{
+	return {
+		.check = unit.hasFlag(_flags.at(section)) ? Qt::Checked : Qt::Unchecked,
+		.flags = unitFlags(section, unit),
+	};
+}
+
+std::optional<qint64> UnitFlagsColumn::sortKey(int section, const Unit &unit) const
+{
+	return unit.hasFlag(_flags.at(section)) ? Qt::Checked : Qt::Unchecked;
+}
+
+QVariant UnitFlagsColumn::groupData(int section, GroupBy::Group group, std::span<const Unit *> units, const GroupAggregate &aggregate, int role) const
 {
 	auto flag = _flags.at(section);
 	auto has_flag = [flag](const Unit *u) { return u->hasFlag(flag); };
 	switch (role) {
 	case Qt::DisplayRole:
-		return int(std::ranges::count_if(units, has_flag));
+		return aggregate.checked;
 	case Qt::CheckStateRole:
-		return std::ranges::all_of(units, has_flag)
-			? Qt::Checked
-			: std::ranges::none_of(units, has_flag)
-				? Qt::Unchecked
-				: Qt::PartiallyChecked;
+		return aggregate.checkState(units.size());
 	case Qt::ToolTipRole: {
 		auto tooltip = QString("<h2>%1</h2>").arg(group.name());
-		auto count = std::ranges::count_if(units, has_flag);
+		auto count = aggregate.checked;
 		if (count > 0) {
 			tooltip.append("<p>"+countText(flag, count)+"</p>");
 			tooltip.append("<ul>");
@@ -96,7 +110,7 @@ QVariant UnitFlagsColumn::groupData(int section, GroupBy::Group group, std::span
 		return tooltip;
 	}
 	case DataRole::SortRole:
-		return int(std::ranges::count_if(units, has_flag));
+		return aggregate.checked;
 	default:
 		return {};
 	}
@@ -160,10 +174,9 @@ Qt::ItemFlags UnitFlagsColumn::unitFlags(int section, const Unit &unit) const
 		return {};
 }
 
-Qt::ItemFlags UnitFlagsColumn::groupFlags(int section, std::span<const Unit *> units) const
+Qt::ItemFlags UnitFlagsColumn::groupFlags(int section, std::span<const Unit *> units, const GroupAggregate &aggregate) const
 {
-	auto flag = _flags.at(section);
-	if (std::ranges::any_of(units, [flag](const Unit *unit) { return unit->canEdit(flag); }))
+	if (aggregate.checkable > 0)
 		return Qt::ItemIsEnabled | Qt::ItemIsUserCheckable;
 	else
 		return {};
@@ -33,14 +33,17 @@ public:
 	~UnitFlagsColumn() override;
 
 	int count() const override;
+	unsigned unitDependencies() const override;
 	QVariant headerData(int section, int role = Qt::DisplayRole) const override;
 	QVariant unitData(int section, const Unit &unit, int role = Qt::DisplayRole) const override;
-	QVariant groupData(int section, GroupBy::Group group, std::span<const Unit *> units, int role = Qt::DisplayRole) const override;
+	QVariant groupData(int section, GroupBy::Group group, std::span<const Unit *> units, const GroupAggregate &aggregate, int role = Qt::DisplayRole) const override;
+	CellState cellState(int section, const Unit &unit) const override;
+	std::optional<qint64> sortKey(int section, const Unit &unit) const override;
 	bool setUnitData(int section, Unit &unit, const QVariant &value, int role = Qt::EditRole) override;
 	bool setGroupData(int section, std::span<Unit *> units, const QVariant &value, int role = Qt::EditRole) override;
 	void toggleUnits(int section, std::span<Unit *> units) override;
 	Qt::ItemFlags unitFlags(int section, const Unit &unit) const override;
-	Qt::ItemFlags groupFlags(int section, std::span<const Unit *> units) const override;
+	Qt::ItemFlags groupFlags(int section, std::span<const Unit *> units, const GroupAggregate &aggregate) const override;
 
 	static Factory makeFactory(const QJsonObject &);
 
@@ -21,6 +21,7 @@
 #include "DwarfFortressData.h"
 #include "WorkDetail.h"
 #include "WorkDetailModel.h"
+#include "ObjectList.h"
 #include "Unit.h"
 #include "DataRole.h"
 #include "Application.h"
@@ -50,6 +51,7 @@ WorkDetailColumn::WorkDetailColumn(DwarfFortressData &df, QObject *parent):
 		});
 	connect(list, &QAbstractItemModel::rowsInserted,
 		this, [this](const QModelIndex &, int first, int last) {
+			invalidateCells();
 			columnsInserted(first, last);
 		});
 	connect(list, &QAbstractItemModel::rowsAboutToBeRemoved,
@@ -58,6 +60,7 @@ WorkDetailColumn::WorkDetailColumn(DwarfFortressData &df, QObject *parent):
 		});
 	connect(list, &QAbstractItemModel::rowsRemoved,
 		this, [this](const QModelIndex &, int first, int last) {
+			invalidateCells();
 			columnsRemoved(first, last);
 		});
 	connect(list, &QAbstractItemModel::rowsAboutToBeMoved,
@@ -66,16 +69,34 @@ WorkDetailColumn::WorkDetailColumn(DwarfFortressData &df, QObject *parent):
 		});
 	connect(list, &QAbstractItemModel::rowsMoved,
 		this, [this](const QModelIndex &, int first, int last, const QModelIndex &, int dest) {
+			invalidateCells();
 			columnsMoved(first, last, dest);
 		});
 	connect(list, &QAbstractItemModel::dataChanged,
 		this, [this](const QModelIndex &first, const QModelIndex &last, const QList<int> &) {
+			invalidateWorkDetailCells(first.row(), last.row());
 			columnDataChanged(first.row(), last.row());
 		});
 	connect(list, &ObjectListBase::unitDataChanged,
 		this, [this](int row, const QItemSelection &units) {
+			invalidateCells(row, units);
 			unitDataChanged(row, row, units);
 		});
+	// Columns are created before the grid view model connects to the unit
+	// list, so the cells are invalidated before the model is notified.
+	auto units = _df.units.get();
+	connect(units, &QAbstractItemModel::rowsInserted,
+		this, &WorkDetailColumn::invalidateCells);
+	connect(units, &QAbstractItemModel::rowsRemoved,
+		this, &WorkDetailColumn::invalidateCells);
+	connect(units, &QAbstractItemModel::rowsMoved,
+		this, &WorkDetailColumn::invalidateCells);
+	connect(units, &QAbstractItemModel::modelReset,
+		this, &WorkDetailColumn::invalidateCells);
+	connect(units, &QAbstractItemModel::dataChanged,
+		this, [this](const QModelIndex &first, const QModelIndex &last, const QList<int> &) {
+			invalidateUnitCells(first.row(), last.row());
+		});
 }
 
 WorkDetailColumn::~WorkDetailColumn()
@@ -87,6 +108,11 @@ int WorkDetailColumn::count() const
 	return _df.work_details->rowCount();
 }
 
+unsigned WorkDetailColumn::unitDependencies() const
+{
+	return Unit::LaborsChanged | Unit::SkillsChanged | Unit::FlagsChanged | Unit::OtherChanged;
+}
+
 QVariant WorkDetailColumn::headerData(int section, int role) const
 {
 	auto wd = _df.work_details->get(section);
@@ -103,55 +129,146 @@ QVariant WorkDetailColumn::headerData(int section, int role) const
 	}
 }
 
-QVariant WorkDetailColumn::unitData(int section, const Unit &unit, int role) const
+static bool hasWorkDetailLabor(const WorkDetail &wd, const df::unit_skill &skill)
 {
-	static const QBrush Working = QColor(0, 255, 0, 64);
-	static const QBrush NotWorking = QColor(255, 0, 0, 64);
+	return labor(skill.id) != df::unit_labor::NONE && wd->allowed_labors.at(labor(skill.id));
+}
 
+WorkDetailColumn::cell_t WorkDetailColumn::makeCell(int section, const Unit &unit) const
+{
 	auto wd = _df.work_details->get(section);
 	Q_ASSERT(wd);
 
-	std::vector<const df::unit_skill *> skills;
+	cell_t cell = {
+		.best_rating = -1,
+		.valid = true,
+		.assigned = wd->isAssigned(unit->id),
+		.background = Background::None,
+		.status = static_cast<uint8_t>(wd->status(unit->id)),
+	};
 	if (auto soul = unit->current_soul.get())
 		for (const auto &skill: soul->skills)
-			if (labor(skill->id) != df::unit_labor::NONE && (*wd)->allowed_labors.at(labor(skill->id)))
-				skills.push_back(skill.get());
+			if (hasWorkDetailLabor(*wd, *skill) && skill->rating > cell.best_rating)
+				cell.best_rating = skill->rating;
+	if (unit.canAssignWork()) {
+		switch ((*wd)->flags.bits.mode) {
+		case df::work_detail_mode::EverybodyDoesThis:
+			if (!unit->flags4.bits.only_do_assigned_jobs || cell.assigned)
+				cell.background = Background::Working;
+			break;
+		case df::work_detail_mode::OnlySelectedDoesThis:
+			if (cell.assigned)
+				cell.background = Background::Working;
+			break;
+		case df::work_detail_mode::NobodyDoesThis:
+			cell.background = Background::NotWorking;
+			break;
+		}
+	}
+	return cell;
+}
+
+WorkDetailColumn::cell_t WorkDetailColumn::cell(int section, const Unit &unit) const
+{
+	auto index = _df.units->find(unit);
+	if (!index.isValid())
+		return makeCell(section, unit);
+	std::size_t columns = count();
+	std::size_t size = _df.units->rowCount() * columns;
+	if (_cells.size() != size)
+		_cells.assign(size, {});
+	auto &cell = _cells[index.row() * columns + section];
+	if (!cell.valid)
+		cell = makeCell(section, unit);
+	return cell;
+}
+
+void WorkDetailColumn::invalidateCells()
+{
+	_cells.clear();
+}
+
+void WorkDetailColumn::invalidateUnitCells(int first, int last)
+{
+	std::size_t columns = count();
+	if (_cells.size() < (last+1) * columns)
+		return invalidateCells();
+	for (std::size_t i = first * columns; i < (last+1) * columns; ++i)
+		_cells[i].valid = false;
+}
+
+void WorkDetailColumn::invalidateWorkDetailCells(int first, int last)
+{
+	std::size_t columns = count();
+	for (std::size_t row = 0; row < _cells.size(); row += columns)
+		for (int section = first; section <= last; ++section)
+			_cells[row + section].valid = false;
+}
+
+void WorkDetailColumn::invalidateCells(int section, const QItemSelection &units)
+{
+	std::size_t columns = count();
+	for (const auto &range: units)
+		for (int row = range.top(); row <= range.bottom(); ++row)
+			if ((row+1) * columns <= _cells.size())
+				_cells[row * columns + section].valid = false;
+}
+
+QBrush WorkDetailColumn::backgroundBrush(Background background)
+{
+	static const QBrush Working = QColor(0, 255, 0, 64);
+	static const QBrush NotWorking = QColor(255, 0, 0, 64);
+	switch (background) {
+	case Background::Working:
+		return Working;
+	case Background::NotWorking:
+		return NotWorking;
+	default:
+		return {};
+	}
+}
+
+static QColor statusColor(int status)
+{
+	switch (status) {
+	case WorkDetail::Pending:
+		return Qt::gray;
+	case WorkDetail::Failed:
+		return Qt::red;
+	default:
+		return {};
+	}
+}
+
+QVariant WorkDetailColumn::unitData(int section, const Unit &unit, int role) const
+{
+	auto c = cell(section, unit);
 	switch (role) {
-	case Qt::DisplayRole: {
-		auto best_skill = std::ranges::max_element(skills, std::less{}, [](auto skill){return skill->rating;});
-		if (best_skill == skills.end())
+	case Qt::DisplayRole:
+		if (c.best_rating < 0)
 			return {};
 		else
-			return static_cast<int>((*best_skill)->rating);
-	}
-	case DataRole::RatingRole: {
-		auto best_skill = std::ranges::max_element(skills, std::less{}, [](auto skill){return skill->rating;});
-		if (best_skill == skills.end())
+			return static_cast<int>(c.best_rating);
+	case DataRole::RatingRole:
+		if (c.best_rating < 0)
 			return 0.0;
 		else
-			return static_cast<int>((*best_skill)->rating)/15.0;
-	}
+			return static_cast<int>(c.best_rating)/15.0;
 	case Qt::CheckStateRole:
-		return wd->isAssigned(unit->id)
-			? Qt::Checked : Qt::Unchecked;
+		return c.assigned ? Qt::Checked : Qt::Unchecked;
 	case Qt::BackgroundRole:
-		if (!unit.canAssignWork())
+		if (c.background == Background::None)
 			return {};
-		switch ((*wd)->flags.bits.mode) {
-		case df::work_detail_mode::EverybodyDoesThis:
-			if (unit->flags4.bits.only_do_assigned_jobs && !wd->isAssigned(unit->id))
-				return {};
-			else
-				return Working;
-		case df::work_detail_mode::OnlySelectedDoesThis:
-			if (wd->isAssigned(unit->id))
-				return Working;
-			else
-				return {};
-		case df::work_detail_mode::NobodyDoesThis:
-			return NotWorking;
-		}
+		else
+			return backgroundBrush(c.background);
 	case Qt::ToolTipRole: {
+		auto wd = _df.work_details->get(section);
+		Q_ASSERT(wd);
+		std::vector<const df::unit_skill *> skills;
+		if (auto soul = unit->current_soul.get())
+			for (const auto &skill: soul->skills)
+				if (hasWorkDetailLabor(*wd, *skill))
+					skills.push_back(skill.get());
 		auto tooltip = tr("<h3>%1 - %2</h3>")
 			.arg(unit.displayName())
 			.arg(wd->displayName());
@@ -167,51 +284,70 @@ QVariant WorkDetailColumn::unitData(int section, const Unit &unit, int role) con
 		return tooltip;
 	}
 	case DataRole::BorderRole: {
-		switch (wd->status(unit->id)) {
-		case WorkDetail::Pending:
-			return QColor(Qt::gray);
-		case WorkDetail::Failed:
-			return QColor(Qt::red);
-		default:
+		auto color = statusColor(c.status);
+		if (color.isValid())
+			return color;
+		else
 			return {};
-		}
 	}
 	case DataRole::SortRole:
 		switch (_sort.option) {
-		case SortBy::Skill: {
-			auto best_skill = std::ranges::max_element(skills, std::less{}, [](auto skill){return skill->rating;});
-			if (best_skill == skills.end())
-				return -1;
-			else
-				return static_cast<int>((*best_skill)->rating);
-		}
+		case SortBy::Skill:
+			return static_cast<int>(c.best_rating);
 		case SortBy::Assigned:
-			return wd->isAssigned(unit->id);
+			return static_cast<bool>(c.assigned);
 		}
 	default:
 		return {};
 	}
 }
 
-QVariant WorkDetailColumn::groupData(int section, GroupBy::Group group, std::span<const Unit *> units, int role) const
+AbstractColumn::CellState WorkDetailColumn::cellState(int section, const Unit &unit) const
+{
+	auto c = cell(section, unit);
+	CellState state;
+	if (c.best_rating < 0)
+		state.rating = 0.0;
+	else {
+		state.text = QString::number(static_cast<int>(c.best_rating));
+		state.rating = static_cast<int>(c.best_rating)/15.0;
+	}
+	state.check = c.assigned ? Qt::Checked : Qt::Unchecked;
+	state.background = backgroundBrush(c.background);
+	if (auto color = statusColor(c.status); color.isValid())
+		state.border = color;
+	state.flags = unitFlags(section, unit);
+	return state;
+}
+
+std::optional<qint64> WorkDetailColumn::sortKey(int section, const Unit &unit) const
+{
+	auto c = cell(section, unit);
+	switch (_sort.option) {
+	case SortBy::Skill:
+		return static_cast<int>(c.best_rating);
+	case SortBy::Assigned:
+		return static_cast<bool>(c.assigned);
+	default:
+		return std::nullopt;
+	}
+}
+
+QVariant WorkDetailColumn::groupData(int section, GroupBy::Group group, std::span<const Unit *> units, const GroupAggregate &aggregate, int role) const
 {
 	auto wd = _df.work_details->get(section);
 	Q_ASSERT(wd);
 
 	auto is_assigned = [wd](const Unit *unit) { return wd->isAssigned((*unit)->id); };
 
-	int count = std::ranges::count_if(units, is_assigned);
+	int count = aggregate.checked;
 
 	switch (role) {
 	case Qt::DisplayRole: {
 		return count;
 	}
 	case Qt::CheckStateRole:
-		return std::ranges::all_of(units, is_assigned)
-			? Qt::Checked
-			: std::ranges::none_of(units, is_assigned)
-				? Qt::Unchecked
-				: Qt::PartiallyChecked;
+		return aggregate.checkState(units.size());
 	case Qt::ToolTipRole: {
 		auto tooltip = tr("<h3>%1 - %2</h3>")
 			.arg(group.name())
@@ -232,15 +368,10 @@ QVariant WorkDetailColumn::groupData(int section, GroupBy::Group group, std::spa
 	case DataRole::SortRole:
 		switch (_sort.option) {
 		case SortBy::Skill: {
-			auto best_rating = std::numeric_limits<int>::min();
-			for (auto unit: units) {
-				if (auto soul = (*unit)->current_soul.get())
-					for (const auto &skill: soul->skills)
-						if (labor(skill->id) != df::unit_labor::NONE
-								&& (*wd)->allowed_labors.at(labor(skill->id))
-								&& skill->rating > best_rating)
-							best_rating = skill->rating;
-			}
+			auto skills = SkillMatrix::laborSkills((*wd)->allowed_labors);
+			int best_rating = -1;
+			for (auto unit: units)
+				best_rating = std::max(best_rating, _df.skills.maxRating(unit->skillRow(), skills));
 			return best_rating;
 		}
 		case SortBy::Assigned:
@@ -295,9 +426,9 @@ Qt::ItemFlags WorkDetailColumn::unitFlags(int section, const Unit &unit) const
 		return {};
 }
 
-Qt::ItemFlags WorkDetailColumn::groupFlags(int section, std::span<const Unit *> units) const
+Qt::ItemFlags WorkDetailColumn::groupFlags(int section, std::span<const Unit *> units, const GroupAggregate &aggregate) const
 {
-	if (std::ranges::any_of(units, [](const Unit *unit) { return unit->canAssignWork(); }))
+	if (aggregate.checkable > 0)
 		return Qt::ItemIsEnabled | Qt::ItemIsUserCheckable;
 	else
 		return {};
@@ -35,14 +35,17 @@ public:
 	~WorkDetailColumn() override;
 
 	int count() const override;
+	unsigned unitDependencies() const override;
 	QVariant headerData(int section, int role = Qt::DisplayRole) const override;
 	QVariant unitData(int section, const Unit &unit, int role = Qt::DisplayRole) const override;
-	QVariant groupData(int section, GroupBy::Group group, std::span<const Unit *> units, int role = Qt::DisplayRole) const override;
+	QVariant groupData(int section, GroupBy::Group group, std::span<const Unit *> units, const GroupAggregate &aggregate, int role = Qt::DisplayRole) const override;
+	CellState cellState(int section, const Unit &unit) const override;
+	std::optional<qint64> sortKey(int section, const Unit &unit) const override;
 	bool setUnitData(int section, Unit &unit, const QVariant &value, int role = Qt::EditRole) override;
 	bool setGroupData(int section, std::span<Unit *> units, const QVariant &value, int role = Qt::EditRole) override;
 	void toggleUnits(int section, std::span<Unit *> units) override;
 	Qt::ItemFlags unitFlags(int section, const Unit &unit) const override;
-	Qt::ItemFlags groupFlags(int section, std::span<const Unit *> units) const override;
+	Qt::ItemFlags groupFlags(int section, std::span<const Unit *> units, const GroupAggregate &aggregate) const override;
 
 	void makeHeaderMenu(int section, QMenu *menu, QWidget *parent) override;
 
@@ -56,6 +59,29 @@ private:
 	};
 	SortOptions<WorkDetailColumn, SortBy> _sort;
 
+	enum class Background: uint8_t {
+		None,
+		Working,
+		NotWorking,
+	};
+	static QBrush backgroundBrush(Background background);
+	// Cached values for a unit/work detail pair
+	struct cell_t {
+		int8_t best_rating; // -1 if there is no matching skill
+		bool valid: 1;
+		bool assigned: 1;
+		Background background: 2;
+		uint8_t status: 2; // WorkDetail::ChangeStatus
+	};
+	// Cells for each unit row and work detail row (unit row major),
+	// invalid cells are computed on access.
+	mutable std::vector<cell_t> _cells;
+	cell_t cell(int section, const Unit &unit) const;
+	cell_t makeCell(int section, const Unit &unit) const;
+	void invalidateCells();
+	void invalidateUnitCells(int first, int last);
+	void invalidateWorkDetailCells(int first, int last);
+	void invalidateCells(int section, const QItemSelection &units);
 };
 
 }
@@ -18,9 +18,16 @@
 
 #include "DFHackProcess.h"
 
+#include "LogCategory.h"
+#include "SharedMemoryRing.h"
+
 #include <QCoroFuture>
+#include <QDeadlineTimer>
+#include <QThread>
 #include <QCoroTask>
 
+#include <cppcoro/when_all.hpp>
+
 #include <dfhack-client-qt/Client.h>
 #include <dfhack-client-qt/Function.h>
 #include <dfhack-client-qt/Core.h>
@@ -41,8 +48,21 @@ static const struct {
 		dfproto::llmemoryreader::ReadRawVIn,
 		dfproto::llmemoryreader::ReadRawVOut
 	> ReadRawV = {"llmemreader", "ReadRawV"};
+	// Shared memory transport: the plugin writes the data in a segment
+	// mapped by both processes instead of sending it on the socket.
+	DFHack::Function<
+		dfproto::StringMessage,
+		dfproto::EmptyMessage
+	> MapSharedMemory = {"llmemreader", "MapSharedMemory"};
+	DFHack::Function<
+		dfproto::llmemoryreader::ReadRawVIn,
+		dfproto::llmemoryreader::ReadRawVOut
+	> ReadRawVShared = {"llmemreader", "ReadRawVShared"};
 } llmemoryreader;
 
+// Pages are only allocated when the plugin writes to them
+static constexpr std::size_t SharedMemoryCapacity = 64*1024*1024;
+
 static uint8_t parse_hexdigit(char c)
 {
 	if (c >= '0' && c <= '9')
@@ -55,10 +75,17 @@ static uint8_t parse_hexdigit(char c)
 		throw std::invalid_argument("not a hexadecimal digit");
 }
 
-DFHackProcess::DFHackProcess(DFHack::Client &client):
-	_client(client)
+// Maximum time for a read on another connection to complete while the
+// game is suspended, before deciding that reads wait for the suspend.
+static constexpr std::chrono::milliseconds SuspendedReadTimeout{1000};
+
+DFHackProcess::DFHackProcess(std::vector<DFHack::Client *> clients):
+	_clients(std::move(clients)),
+	_suspended(false),
+	_parallel_suspended_reads(false)
 {
-	auto [reply, notifications] = llmemoryreader.GetInfo(_client);
+	Q_ASSERT(!_clients.empty());
+	auto [reply, notifications] = llmemoryreader.GetInfo(*_clients.front());
 	reply.waitForFinished();
 	auto info = reply.result();
 	if (!info)
@@ -80,6 +107,56 @@ DFHackProcess::DFHackProcess(DFHack::Client &client):
 		throw std::runtime_error("Missing PE timestamp/MD5 sum");
 	}
 	_base_offset = info->base_offset();
+	_shared_ring = mapSharedMemory();
+	if (_clients.size() > 1)
+		_parallel_suspended_reads = testParallelSuspendedReads();
+}
+
+bool DFHackProcess::testParallelSuspendedReads()
+{
+	// DFHack suspends the core for each RPC unless the function is
+	// registered with SF_DONT_SUSPEND, such a read would wait for the
+	// suspend held by the first connection.
+	auto [suspend, suspend_notifications] = Core.suspend(*_clients.front());
+	suspend.waitForFinished();
+	if (!suspend.result())
+		return false;
+	auto [reply, notifications] = llmemoryreader.ReadRawV(*_clients[1], llmemoryreader.ReadRawV.args());
+	QDeadlineTimer deadline(SuspendedReadTimeout);
+	while (!reply.isFinished() && !deadline.hasExpired())
+		QThread::msleep(10);
+	bool parallel = reply.isFinished();
+	auto [resume, resume_notifications] = Core.resume(*_clients.front());
+	resume.waitForFinished();
+	reply.waitForFinished();
+	if (!parallel)
+		qCWarning(DFHackLog) << "Memory reads wait for suspended game, reading from only one connection";
+	return parallel;
+}
+
+std::unique_ptr<SharedMemoryRing> DFHackProcess::mapSharedMemory()
+{
+	std::unique_ptr<SharedMemoryRing> ring;
+	try {
+		ring = std::make_unique<SharedMemoryRing>(SharedMemoryCapacity);
+	}
+	catch (std::exception &e) {
+		qCInfo(DFHackLog) << "Failed to create shared memory:" << e.what();
+		return nullptr;
+	}
+	// Older plugins do not have the function and a plugin in another
+	// machine or in wine cannot open the segment, both fail the call.
+	auto args = llmemoryreader.MapSharedMemory.args();
+	args.set_value(ring->name());
+	auto [reply, notifications] = llmemoryreader.MapSharedMemory(*_clients.front(), args);
+	reply.waitForFinished();
+	if (auto r = reply.result(); !r) {
+		qCInfo(DFHackLog) << "Shared memory is not available:" << make_error_code(r.cr).message();
+		return nullptr;
+	}
+	ring->unlink(); // the plugin keeps its own mapping
+	qCInfo(DFHackLog) << "Reading memory through shared memory" << ring->name();
+	return ring;
 }
 
 DFHackProcess::~DFHackProcess()
@@ -88,16 +165,22 @@ DFHackProcess::~DFHackProcess()
 
 std::error_code DFHackProcess::stop()
 {
-	auto [reply, notifications] = Core.suspend(_client);
+	auto [reply, notifications] = Core.suspend(*_clients.front());
 	reply.waitForFinished();
-	return reply.result().cr;
+	auto r = reply.result();
+	if (r)
+		_suspended = true;
+	return r.cr;
 }
 
 std::error_code DFHackProcess::cont()
 {
-	auto [reply, notifications] = Core.resume(_client);
+	auto [reply, notifications] = Core.resume(*_clients.front());
 	reply.waitForFinished();
-	return reply.result().cr;
+	auto r = reply.result();
+	if (r)
+		_suspended = false;
+	return r.cr;
 }
 
 [[nodiscard]] cppcoro::task<std::error_code> DFHackProcess::read(dfs::MemoryBufferRef buffer)
@@ -105,7 +188,7 @@ std::error_code DFHackProcess::cont()
 	auto args = llmemoryreader.ReadRaw.args();
 	args.set_address(buffer.address);
 	args.set_length(buffer.data.size());
-	auto [reply, notifications] = llmemoryreader.ReadRaw(_client, args);
+	auto [reply, notifications] = llmemoryreader.ReadRaw(*_clients.front(), args);
 	auto r = co_await qCoro(reply).waitForFinished();
 	if (!r)
 		co_return r.cr;
@@ -121,13 +204,53 @@ std::error_code DFHackProcess::cont()
 
 [[nodiscard]] cppcoro::task<std::error_code> DFHackProcess::readv(std::span<const dfs::MemoryBufferRef> tasks)
 {
+	if (_clients.size() == 1 || tasks.size() <= 1 || (_suspended && !_parallel_suspended_reads))
+		co_return co_await readvStripe(*_clients.front(), tasks);
+	// Split the ranges in contiguous stripes of similar size, one for
+	// each connection, and read them in parallel.
+	std::size_t total = 0;
+	for (const auto &task: tasks)
+		total += task.data.size();
+	auto stripe_size = (total + _clients.size() - 1) / _clients.size();
+	std::vector<cppcoro::task<std::error_code>> stripes;
+	auto begin = tasks.begin();
+	std::size_t current = 0;
+	for (auto it = tasks.begin(); it != tasks.end(); ++it) {
+		current += it->data.size();
+		if (current >= stripe_size && stripes.size()+1 < _clients.size()) {
+			stripes.push_back(readvStripe(*_clients[stripes.size()], {begin, it+1}));
+			begin = it+1;
+			current = 0;
+		}
+	}
+	if (begin != tasks.end())
+		stripes.push_back(readvStripe(*_clients[stripes.size()], {begin, tasks.end()}));
+	for (auto err: co_await cppcoro::when_all(std::move(stripes)))
+		if (err)
+			co_return err;
+	co_return std::error_code{};
+}
+
+[[nodiscard]] cppcoro::task<std::error_code> DFHackProcess::readvStripe(DFHack::Client &client, std::span<const dfs::MemoryBufferRef> tasks)
+{
+	if (_shared_ring) {
+		std::size_t total = 0;
+		for (const auto &task: tasks)
+			total += task.data.size();
+		if (auto offset = _shared_ring->allocate(total)) {
+			auto err = co_await readvShared(client, tasks, *offset, total);
+			_shared_ring->release(*offset);
+			co_return err;
+		}
+		// else the ring is full or the request is too large, use the socket
+	}
 	auto args = llmemoryreader.ReadRawV.args();
 	for (const auto &task: tasks) {
 		auto in = args.add_list();
 		in->set_address(task.address);
 		in->set_length(task.data.size());
 	}
-	auto [reply, notifications] = llmemoryreader.ReadRawV(_client, args);
+	auto [reply, notifications] = llmemoryreader.ReadRawV(client, args);
 	auto r = co_await qCoro(reply).waitForFinished();
 	if (!r)
 		co_return r.cr;
@@ -145,6 +268,41 @@ std::error_code DFHackProcess::cont()
 	co_return std::error_code{};
 }
 
+[[nodiscard]] cppcoro::task<std::error_code> DFHackProcess::readvShared(DFHack::Client &client, std::span<const dfs::MemoryBufferRef> tasks, std::size_t offset, std::size_t size)
+{
+	auto args = llmemoryreader.ReadRawVShared.args();
+	// First item is the destination range in the shared memory, data for
+	// each following range is written contiguously.
+	auto dest = args.add_list();
+	dest->set_address(offset);
+	dest->set_length(size);
+	for (const auto &task: tasks) {
+		auto in = args.add_list();
+		in->set_address(task.address);
+		in->set_length(task.data.size());
+	}
+	auto [reply, notifications] = llmemoryreader.ReadRawVShared(client, args);
+	auto r = co_await qCoro(reply).waitForFinished();
+	if (!r)
+		co_return r.cr;
+	if (std::size_t(r->list_size()) != tasks.size()) {
+		qWarning() << "read error: invalid reply size";
+		co_return DFHack::CommandResult::Failure;
+	}
+	for (std::size_t i = 0; i < tasks.size(); ++i) {
+		auto out = r->list(i);
+		auto &task = tasks[i];
+		if (out.has_error_message()) {
+			qWarning() << "read error:" << out.error_message();
+			co_return DFHack::CommandResult::Failure;
+		}
+		auto data = _shared_ring->data(offset, task.data.size());
+		std::memcpy(task.data.data(), data.data(), data.size());
+		offset += task.data.size();
+	}
+	co_return std::error_code{};
+}
+
 void DFHackProcess::sync(cppcoro::task<> &&task)
 {
 	QCoro::waitFor(std::move(task));
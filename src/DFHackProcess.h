@@ -21,12 +21,29 @@
 
 #include <dfs/Process.h>
 
+#include <memory>
+#include <vector>
+
 namespace DFHack { class Client; }
+class SharedMemoryRing;
 
 class DFHackProcess: public dfs::Process
 {
 public:
-	DFHackProcess(DFHack::Client &client);
+	// Memory is read through all clients in parallel, the first one is
+	// also used for suspending the game. DFHack suspends the game for
+	// each call unless the function is registered with SF_DONT_SUSPEND,
+	// so parallel reads are only faster with such a plugin. While the
+	// game is suspended, reads only use the first client unless the
+	// server was found to answer reads on other connections during a
+	// suspend, otherwise they would wait for the resume forever. The
+	// test is done once per process: a slow server only makes it fall
+	// back to the first client until the next connection.
+	//
+	// If llmemreader can map a shared memory segment created by this
+	// process (MapSharedMemory), batched reads are written there by the
+	// plugin (ReadRawVShared) instead of being sent on the socket.
+	DFHackProcess(std::vector<DFHack::Client *> clients);
 	~DFHackProcess() override;
 
 	std::span<const uint8_t> id() const override
@@ -47,9 +64,17 @@ public:
 	void sync(cppcoro::task<> &&task) override;
 
 private:
-	DFHack::Client &_client;
+	bool testParallelSuspendedReads();
+	std::unique_ptr<SharedMemoryRing> mapSharedMemory();
+	[[nodiscard]] cppcoro::task<std::error_code> readvStripe(DFHack::Client &client, std::span<const dfs::MemoryBufferRef> tasks);
+	[[nodiscard]] cppcoro::task<std::error_code> readvShared(DFHack::Client &client, std::span<const dfs::MemoryBufferRef> tasks, std::size_t offset, std::size_t size);
+
+	std::vector<DFHack::Client *> _clients;
 	std::vector<uint8_t> _id;
 	intptr_t _base_offset;
+	bool _suspended;
+	bool _parallel_suspended_reads;
+	std::unique_ptr<SharedMemoryRing> _shared_ring; // null when reading through the socket
 
 };
 
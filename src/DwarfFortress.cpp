@@ -18,6 +18,7 @@
 
 #include "DwarfFortress.h"
 
+#include <QElapsedTimer>
 #include <QtConcurrent>
 #include <QCoroFuture>
 #include <QCoroSignal>
@@ -53,13 +54,19 @@ static const DFHack::Function<
 	dfproto::EmptyMessage,
 	dfproto::workdetailtest::GameState
 > GetGameState = {"workdetailtest", "GetGameState"};
+static const DFHack::Function<
+	dfproto::EmptyMessage,
+	dfproto::StringMessage // packed unit records, see DwarfFortressReader::parseUnitRecords
+> GetUnits = {"workdetailtest", "GetUnits"};
 
 DwarfFortress::DwarfFortress(QObject *parent):
 	QObject(parent),
 	_state(Disconnected),
+	_process_pid(0),
 	_world_loaded(0),
 	_map_loaded(0),
-	_last_viewscreen(Viewscreen::Other)
+	_last_viewscreen(Viewscreen::Other),
+	_use_unit_records(false)
 {
 	_data = std::make_shared<DwarfFortressData>(&_dfhack);
 
@@ -90,6 +97,8 @@ DwarfFortress::~DwarfFortress()
 			qDebug() << "Waiting for running coroutines...";
 			co_await qCoro(&_coroutine_counter, &Counter::zero);
 		}
+		_process.reset();
+		co_await closeReadConnections();
 	}());
 	_dfhack.QObject::disconnect(this);
 	qDebug() << "DwarfFortress cleaned up";
@@ -137,41 +146,76 @@ QCoro::Task<bool> DwarfFortress::connectToDF(const QString &host, quint16 port)
 				.arg(ErrorCodeMessage(process_info.cr));
 
 		connectionProgress(tr("Opening DF process"));
-		co_await QtConcurrent::run([this, &process_info](){
-			std::unique_ptr<dfs::Process> process = nullptr;
-			if (Application::settings().use_native_process())
+		std::unique_ptr<dfs::Process> process = nullptr;
+		if (Application::settings().use_native_process())
+			co_await QtConcurrent::run([&process, &process_info](){
 				process = findNativeProcess(*process_info);
-			if (!process) {
-				qCInfo(ProcessLog) << "Fallback to DFHack for memory access";
-				process = std::make_unique<DFHackProcess>(_dfhack);
+			});
+		_use_unit_records = false;
+		if (!process) {
+			qCInfo(ProcessLog) << "Fallback to DFHack for memory access";
+			// Memory reads use their own connections so that they do
+			// not delay edits on the main connection.
+			std::vector<DFHack::Client *> clients;
+			for (int i = 0; i < Application::settings().dfhack_read_connections(); ++i) {
+				auto client = std::make_unique<DFHack::Client>();
+				if (!co_await client->connect(host, port)) {
+					qCWarning(DFHackLog) << "Failed to open read connection" << i;
+					break;
+				}
+				clients.push_back(client.get());
+				_dfhack_readers.push_back(std::move(client));
 			}
-			_process = std::make_unique<dfs::ProcessVectorizer>(
+			if (clients.empty())
+				clients.push_back(&_dfhack);
+			qCInfo(DFHackLog) << "Using" << clients.size() << "connections for reading memory";
+			co_await QtConcurrent::run([&process, &clients](){
+				process = std::make_unique<DFHackProcess>(std::move(clients));
+			});
+			_use_unit_records = Application::settings().use_unit_records();
+		}
+		if (!process)
+			throw tr("Failed to open DF process");
+		_process = std::make_unique<dfs::ProcessVectorizer>(
 #ifdef QT_DEBUG
-					std::make_unique<ProcessStats>(std::move(process)),
+				std::make_unique<ProcessStats>(std::move(process)),
 #else
-					std::move(process),
+				std::move(process),
 #endif
-					48*1024*1024); // keep a margin below DFHack max message size for protocol overhead
-		});
-		if (!_process)
-			throw tr("Failed to open DF process");
+				48*1024*1024); // keep a margin below DFHack max message size for protocol overhead
 		qCInfo(ProcessLog) << "Process id" << StructuresManager::idToString(_process->id());
-		auto structures_info = Application::structures().findVersion(_process->id());
-		if (!structures_info)
-			throw tr("Unsupported DF version");
-		auto structures = structures_info->structures;
-		auto version = structures_info->version;
-		qCInfo(StructuresLog) << "Version found as" << version->version_name
-				<< "from" << structures_info->source;
-		_reader_factory = std::make_unique<dfs::ReaderFactory>(*structures, *version);
-		_reader_factory->log = StructuresLogger;
+		if (_reader_factory && std::ranges::equal(_process->id(), _process_id)
+				&& process_info->pid() == _process_pid) {
+			// Same process as the previous connection, keep the reader
+			// factory and data, update will check if the world is still
+			// the same. A restarted DF with the same executable has a
+			// different pid and its data is read again.
+			qCInfo(ProcessLog) << "Reusing data from previous connection";
+		}
+		else {
+			_reader_factory.reset();
+			clearData();
+			auto structures_info = Application::structures().findVersion(_process->id());
+			if (!structures_info)
+				throw tr("Unsupported DF version");
+			auto structures = structures_info->structures;
+			auto version = structures_info->version;
+			qCInfo(StructuresLog) << "Version found as" << version->version_name
+					<< "from" << structures_info->source;
+			_reader_factory = std::make_unique<dfs::ReaderFactory>(*structures, *version);
+			_reader_factory->log = StructuresLogger;
+			_process_id.assign(_process->id().begin(), _process->id().end());
+			_process_pid = process_info->pid();
+		}
 
 		setState(Connected);
 		update();
 	}
 	catch (std::exception &e) {
 		_reader_factory.reset();
+		_process_id.clear();
 		_process.reset();
+		clearData();
 		_dfhack.disconnect();
 		qCritical() << "Failed to connect" << e.what();
 		error(e.what());
@@ -179,7 +223,9 @@ QCoro::Task<bool> DwarfFortress::connectToDF(const QString &host, quint16 port)
 	}
 	catch (QString &message) {
 		_reader_factory.reset();
+		_process_id.clear();
 		_process.reset();
+		clearData();
 		_dfhack.disconnect();
 		qCritical() << "Failed to connect" << message;
 		error(message);
@@ -192,6 +238,10 @@ QCoro::Task<> DwarfFortress::disconnectFromDF()
 {
 	CounterGuard coroutine_guard(_coroutine_counter);
 	co_await _dfhack.disconnect();
+	// Explicit disconnection: do not keep data for reconnecting
+	_reader_factory.reset();
+	_process_id.clear();
+	clearData();
 }
 
 QCoro::Task<bool> DwarfFortress::heartbeat()
@@ -257,8 +307,36 @@ QCoro::Task<bool> DwarfFortress::update()
 			}
 			if (_world_loaded != 0) {
 				connectionProgress(tr("Loading game data"));
-				auto data = reader.loadGameData();
+				QElapsedTimer timer;
+				timer.start();
+				std::unique_ptr<df_game_data> data;
+				if (_use_unit_records) {
+					auto &client = _dfhack_readers.empty() ? _dfhack : *_dfhack_readers.front();
+					auto [reply, notifications] = GetUnits(client);
+					reply.waitForFinished();
+					if (auto r = reply.result(); r) {
+						try {
+							auto units = DwarfFortressReader::parseUnitRecords(r->value());
+							data = reader.loadGameData(false);
+							data->units = std::move(units);
+						}
+						catch (std::runtime_error &e) {
+							qCWarning(DFHackLog) << "Invalid unit records, reading units from memory:" << e.what();
+							_use_unit_records = false;
+						}
+					}
+					else {
+						qCWarning(DFHackLog) << "Failed to get unit records, reading units from memory:"
+							<< ErrorCodeMessage(r.cr);
+						_use_unit_records = false;
+					}
+				}
+				if (!data)
+					data = reader.loadGameData();
+				qCInfo(ProcessLog) << "Game data loaded in" << timer.elapsed() << "ms"
+					<< (_use_unit_records ? "using unit records" : "from memory");
 				QMetaObject::invokeMethod(this, [this, data = std::move(data)]() mutable {
+					unitInventoryAvailable(!_use_unit_records);
 					_map_loaded = data->map_block_index;
 					auto units = &data->units;
 					_last_viewscreen = Viewscreen::Other;
@@ -302,11 +380,23 @@ void DwarfFortress::onConnectionChanged(bool connected)
 				qDebug() << "All coroutines finished";
 			}
 		}());
-		clearData();
+		// Keep the reader factory and data in case the connection is
+		// restored to the same process (e.g. after a plugin reload),
+		// only the process needs to be reopened.
+		_process.reset();
+		QCoro::waitFor(closeReadConnections());
 		setState(Disconnected);
 	}
 }
 
+QCoro::Task<> DwarfFortress::closeReadConnections()
+{
+	auto readers = std::move(_dfhack_readers);
+	_dfhack_readers.clear();
+	for (auto &client: readers)
+		co_await client->disconnect();
+}
+
 void DwarfFortress::onNotification(DFHack::Color color, const QString &text)
 {
 	qCInfo(DFHackLog) << text;
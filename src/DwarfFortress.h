@@ -71,6 +71,8 @@ signals:
 	void stateChanged(State);
 	void error(const QString &);
 	void connectionProgress(const QString &);
+	// Unit records do not contain inventories
+	void unitInventoryAvailable(bool);
 
 private slots:
 	void onConnectionChanged(bool);
@@ -93,13 +95,19 @@ private:
 	// Process info
 	static std::unique_ptr<dfs::Process> findNativeProcess(const dfproto::workdetailtest::ProcessInfo &info);
 	std::unique_ptr<dfs::Process> _process;
+	// Additional connections used by DFHackProcess for reading memory
+	std::vector<std::unique_ptr<DFHack::Client>> _dfhack_readers;
+	QCoro::Task<> closeReadConnections();
 	std::unique_ptr<dfs::ReaderFactory> _reader_factory;
+	std::vector<uint8_t> _process_id; // id used for creating _reader_factory
+	uint32_t _process_pid; // pid of the process the cached data was read from
 	uintptr_t _world_loaded;
 	uintptr_t _map_loaded;
 	enum class Viewscreen {
 		SetupDwarfGame,
 		Other
 	} _last_viewscreen;
+	bool _use_unit_records; // read units from the plugin instead of DF memory
 
 	dfs::ReadSession::shared_objects_cache_t _shared_raws_objects;
 	std::shared_ptr<DwarfFortressData> _data;
@@ -20,6 +20,8 @@
 
 #include <ObjectList.h>
 #include <Unit.h>
+#include <UnitNameIndex.h>
+#include <UnitTable.h>
 #include <WorkDetail.h>
 #include <WorkDetailModel.h>
 
@@ -28,6 +30,8 @@
 DwarfFortressData::DwarfFortressData(QPointer<DFHack::Client> dfhack):
 	dfhack(dfhack),
 	units(std::make_unique<ObjectList<Unit>>()),
+	unit_names(std::make_unique<UnitNameIndex>(*units)),
+	unit_table(std::make_unique<UnitTable>(*units)),
 	work_details(std::make_unique<WorkDetailModel>(*this))
 {
 }
@@ -102,6 +106,7 @@ DwarfFortressData::findMaterial(int type, int index) const
 
 void DwarfFortressData::updateRaws(std::unique_ptr<df::world_raws> &&new_raws)
 {
+	units->aboutToUpdate();
 	raws = std::move(new_raws);
 }
 
@@ -109,6 +114,9 @@ void DwarfFortressData::updateGameData(
 		std::unique_ptr<df_game_data> &&new_data,
 		std::vector<std::unique_ptr<df::unit>> &&new_units)
 {
+	// Units read the other members, readers must stop before any of them
+	// changes.
+	units->aboutToUpdate();
 	current_civ_id = new_data->current_civ_id;
 	current_group_id = new_data->current_group_id;
 	current_time = df::time(new_data->current_year) + new_data->current_tick;
@@ -125,6 +133,7 @@ void DwarfFortressData::updateGameData(
 
 void DwarfFortressData::clear()
 {
+	units->aboutToUpdate();
 	units->clear();
 	work_details->clear();
 
@@ -20,10 +20,13 @@
 #define DWARF_FORTRESS_DATA_H
 
 #include "DwarfFortressReader.h"
+#include "SkillMatrix.h"
 
 #include <QPointer>
 
 class Unit;
+class UnitNameIndex;
+class UnitTable;
 class WorkDetailModel;
 template <typename T>
 class ObjectList;
@@ -42,7 +45,10 @@ struct DwarfFortressData: public std::enable_shared_from_this<DwarfFortressData>
 	std::vector<std::unique_ptr<df::historical_entity>> entities;
 	std::vector<std::unique_ptr<df::historical_figure>> histfigs;
 	std::vector<std::unique_ptr<df::identity>> identities;
+	SkillMatrix skills; // rows are released by units, must outlive them
 	std::unique_ptr<ObjectList<Unit>> units;
+	std::unique_ptr<UnitNameIndex> unit_names;
+	std::unique_ptr<UnitTable> unit_table;
 	std::unique_ptr<WorkDetailModel> work_details;
 
 	using material_origin = std::variant<std::monostate,
@@ -26,6 +26,11 @@ Q_DECLARE_LOGGING_CATEGORY(StructuresLog);
 #include <df/types.h>
 #include <df/items.h>
 
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+
 using namespace dfs;
 
 template <static_string Path, auto Output>
@@ -159,33 +164,369 @@ std::unique_ptr<df::world_raws> DwarfFortressReader::loadRaws()
 	return std::move(raws.raws);
 }
 
+using df_game_data_without_units_reads = std::tuple<
+	GlobalRead<"gview.view", [](df_game_data &self) -> decltype(auto) { return *self.viewscreen; }>,
+	GlobalRead<"plotinfo.civ_id", &df_game_data::current_civ_id>,
+	GlobalRead<"plotinfo.group_id", &df_game_data::current_group_id>,
+	GlobalRead<"cur_year", &df_game_data::current_year>,
+	GlobalRead<"cur_year_tick", &df_game_data::current_tick>,
+	GlobalRead<"world.entities.all", &df_game_data::entities>,
+	GlobalRead<"world.history.figures", &df_game_data::histfigs>,
+	GlobalRead<"world.identities.all", &df_game_data::identities>,
+	GlobalRead<"plotinfo.labor_info.work_details", &df_game_data::work_details>,
+	GlobalRead<"world.map.block_index", &df_game_data::map_block_index>
+>;
+
 template <>
 struct reads<df_game_data>
 {
-	using type = std::tuple<
-		GlobalRead<"gview.view", [](df_game_data &self) -> decltype(auto) { return *self.viewscreen; }>,
-		GlobalRead<"plotinfo.civ_id", &df_game_data::current_civ_id>,
-		GlobalRead<"plotinfo.group_id", &df_game_data::current_group_id>,
-		GlobalRead<"cur_year", &df_game_data::current_year>,
-		GlobalRead<"cur_year_tick", &df_game_data::current_tick>,
-		GlobalRead<"world.units.all", &df_game_data::units>,
-		GlobalRead<"world.entities.all", &df_game_data::entities>,
-		GlobalRead<"world.history.figures", &df_game_data::histfigs>,
-		GlobalRead<"world.identities.all", &df_game_data::identities>,
-		GlobalRead<"plotinfo.labor_info.work_details", &df_game_data::work_details>,
-		GlobalRead<"world.map.block_index", &df_game_data::map_block_index>
-	>;
+	using type = decltype(std::tuple_cat(
+		df_game_data_without_units_reads{},
+		std::tuple<GlobalRead<"world.units.all", &df_game_data::units>>{}
+	));
 };
 
-std::unique_ptr<df_game_data> DwarfFortressReader::loadGameData()
+std::unique_ptr<df_game_data> DwarfFortressReader::loadGameData(bool with_units)
 {
 	auto data = std::make_unique<df_game_data>();
 	data->viewscreen = std::make_unique<df::viewscreen>();
-	if (!read_all(session, *data))
+	bool ok = with_units
+		? read_all(session, *data)
+		: read_all_t<df_game_data_without_units_reads>{}(session, *data);
+	if (!ok)
 		throw std::runtime_error("Error while reading game data");
 	return data;
 }
 
+namespace {
+
+// Unit records are written by the plugin in the byte order of the DF
+// process (always little endian).
+//
+// Header: magic "WDTU", uint16 version, uint16 reserved, uint32 unit count
+// Each unit: uint32 size of the record following this field, the fields
+// read in parseUnit. Readers skip trailing data they do not know about.
+class UnitRecordParser
+{
+public:
+	UnitRecordParser(std::string_view data): _data(data), _pos(0) {}
+
+	std::size_t pos() const { return _pos; }
+
+	void seek(std::size_t pos) {
+		if (pos > _data.size())
+			throw std::runtime_error("Truncated unit record");
+		_pos = pos;
+	}
+
+	template <typename T>
+	T read() {
+		static_assert(std::endian::native == std::endian::little);
+		T value;
+		if (_data.size() - _pos < sizeof(T))
+			throw std::runtime_error("Truncated unit record");
+		std::memcpy(&value, _data.data() + _pos, sizeof(T));
+		_pos += sizeof(T);
+		return value;
+	}
+
+	template <typename Wire, typename T>
+	void read_as(T &out) {
+		out = static_cast<T>(read<Wire>());
+	}
+
+	template <typename Wire, typename T>
+	void read_duration(T &out) {
+		out = T(read<Wire>());
+	}
+
+	template <typename T>
+	void read_flags(T &out) {
+		static_assert(sizeof(T) == sizeof(uint32_t));
+		auto value = read<uint32_t>();
+		std::memcpy(&out, &value, sizeof(T));
+	}
+
+	void read_string(std::string &out) {
+		auto size = read<uint16_t>();
+		if (_data.size() - _pos < size)
+			throw std::runtime_error("Truncated unit record");
+		out.assign(_data.substr(_pos, size));
+		_pos += size;
+	}
+
+	template <std::size_t N>
+	void read_attributes(std::array<df::unit_attribute, N> &attrs) {
+		auto count = read<uint8_t>();
+		if (count != N)
+			throw std::runtime_error("Invalid attribute count in unit record");
+		for (auto &attr: attrs) {
+			read_as<int32_t>(attr.value);
+			read_as<int32_t>(attr.max_value);
+			read_as<int32_t>(attr.soft_demotion);
+		}
+	}
+
+	template <typename T, std::size_t N>
+	void read_array(std::array<T, N> &array) {
+		auto count = read<uint8_t>();
+		if (count != N)
+			throw std::runtime_error("Invalid array size in unit record");
+		for (auto &v: array)
+			read_as<int32_t>(v);
+	}
+
+	std::unique_ptr<df::unit> parseUnit();
+
+private:
+	std::string_view _data;
+	std::size_t _pos;
+};
+
+std::unique_ptr<df::unit> UnitRecordParser::parseUnit()
+{
+	auto u = std::make_unique<df::unit>();
+	read_as<int32_t>(u->id);
+	read_as<int32_t>(u->race);
+	read_as<int16_t>(u->caste);
+	read_as<int16_t>(u->profession);
+	read_as<int32_t>(u->civ_id);
+	read_as<int16_t>(u->mood);
+	read_as<int32_t>(u->hist_figure_id);
+	read_as<int32_t>(u->pet_owner);
+	read_flags(u->flags1);
+	read_flags(u->flags2);
+	read_flags(u->flags3);
+	read_flags(u->flags4);
+	read_duration<int32_t>(u->birth_year);
+	read_duration<int32_t>(u->birth_tick);
+	read_duration<int64_t>(u->time_on_site);
+	u->undead = read<uint8_t>(); // only used as a boolean
+
+	// name
+	read_string(u->name.first_name);
+	read_string(u->name.nickname);
+	for (auto &word: u->name.words)
+		read_as<int32_t>(word);
+	for (auto &part: u->name.parts_of_speech)
+		read_as<int16_t>(part);
+	read_as<int32_t>(u->name.language);
+
+	// curse
+	read_flags(u->curse.add_tags1);
+	read_flags(u->curse.rem_tags1);
+	if (read<uint8_t>()) {
+		auto change = std::make_unique<df::curse_attr_change>();
+		read_array(change->physical_att_perc);
+		read_array(change->physical_att_add);
+		read_array(change->mental_att_perc);
+		read_array(change->mental_att_add);
+		u->curse.attr_change = std::move(change);
+	}
+
+	read_attributes(u->physical_attrs);
+	if (read<uint8_t>()) {
+		auto soul = std::make_unique<df::unit_soul>();
+		read_attributes(soul->mental_attrs);
+		auto skill_count = read<uint16_t>();
+		soul->skills.reserve(skill_count);
+		for (int i = 0; i < skill_count; ++i) {
+			auto skill = std::make_unique<df::unit_skill>();
+			read_as<int16_t>(skill->id);
+			read_as<int16_t>(skill->rating);
+			read_as<int32_t>(skill->experience);
+			read_as<int32_t>(skill->rusty);
+			soul->skills.push_back(std::move(skill));
+		}
+		u->current_soul = std::move(soul);
+	}
+
+	auto labor_count = read<uint16_t>();
+	if (labor_count != u->labors.size())
+		throw std::runtime_error("Invalid labor count in unit record");
+	for (auto &labor: u->labors)
+		labor = read<uint8_t>() != 0;
+
+	auto occupation_count = read<uint16_t>();
+	u->occupations.reserve(occupation_count);
+	for (int i = 0; i < occupation_count; ++i) {
+		auto occupation = std::make_unique<df::occupation>();
+		read_as<int16_t>(occupation->type);
+		u->occupations.push_back(std::move(occupation));
+	}
+	return u;
+}
+
+// Inverse of UnitRecordParser, used by the mock DFHack server.
+class UnitRecordWriter
+{
+public:
+	std::string &data() { return _data; }
+
+	template <typename T>
+	void write(T value) {
+		static_assert(std::endian::native == std::endian::little);
+		_data.append(reinterpret_cast<const char *>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	void patch(std::size_t pos, T value) {
+		std::memcpy(_data.data() + pos, &value, sizeof(T));
+	}
+
+	template <typename Wire, typename T>
+	void write_as(const T &value) {
+		write(static_cast<Wire>(value));
+	}
+
+	template <typename Wire, typename T>
+	void write_duration(const T &value) {
+		write(static_cast<Wire>(value.count()));
+	}
+
+	template <typename T>
+	void write_flags(const T &flags) {
+		static_assert(sizeof(T) == sizeof(uint32_t));
+		uint32_t value;
+		std::memcpy(&value, &flags, sizeof(T));
+		write(value);
+	}
+
+	void write_string(const std::string &str) {
+		auto size = std::min<std::size_t>(str.size(), std::numeric_limits<uint16_t>::max());
+		write<uint16_t>(size);
+		_data.append(str.data(), size);
+	}
+
+	template <std::size_t N>
+	void write_attributes(const std::array<df::unit_attribute, N> &attrs) {
+		write<uint8_t>(N);
+		for (const auto &attr: attrs) {
+			write_as<int32_t>(attr.value);
+			write_as<int32_t>(attr.max_value);
+			write_as<int32_t>(attr.soft_demotion);
+		}
+	}
+
+	template <typename T, std::size_t N>
+	void write_array(const std::array<T, N> &array) {
+		write<uint8_t>(N);
+		for (const auto &v: array)
+			write_as<int32_t>(v);
+	}
+
+	void writeUnit(const df::unit &u);
+
+private:
+	std::string _data;
+};
+
+void UnitRecordWriter::writeUnit(const df::unit &u)
+{
+	write_as<int32_t>(u.id);
+	write_as<int32_t>(u.race);
+	write_as<int16_t>(u.caste);
+	write_as<int16_t>(u.profession);
+	write_as<int32_t>(u.civ_id);
+	write_as<int16_t>(u.mood);
+	write_as<int32_t>(u.hist_figure_id);
+	write_as<int32_t>(u.pet_owner);
+	write_flags(u.flags1);
+	write_flags(u.flags2);
+	write_flags(u.flags3);
+	write_flags(u.flags4);
+	write_duration<int32_t>(u.birth_year);
+	write_duration<int32_t>(u.birth_tick);
+	write_duration<int64_t>(u.time_on_site);
+	write<uint8_t>(u.undead != 0);
+
+	// name
+	write_string(u.name.first_name);
+	write_string(u.name.nickname);
+	for (const auto &word: u.name.words)
+		write_as<int32_t>(word);
+	for (const auto &part: u.name.parts_of_speech)
+		write_as<int16_t>(part);
+	write_as<int32_t>(u.name.language);
+
+	// curse
+	write_flags(u.curse.add_tags1);
+	write_flags(u.curse.rem_tags1);
+	write<uint8_t>(u.curse.attr_change != nullptr);
+	if (const auto &change = u.curse.attr_change) {
+		write_array(change->physical_att_perc);
+		write_array(change->physical_att_add);
+		write_array(change->mental_att_perc);
+		write_array(change->mental_att_add);
+	}
+
+	write_attributes(u.physical_attrs);
+	write<uint8_t>(u.current_soul != nullptr);
+	if (const auto &soul = u.current_soul) {
+		write_attributes(soul->mental_attrs);
+		auto skill_count = std::min<std::size_t>(soul->skills.size(), std::numeric_limits<uint16_t>::max());
+		write<uint16_t>(skill_count);
+		for (std::size_t i = 0; i < skill_count; ++i) {
+			const auto &skill = soul->skills[i];
+			write_as<int16_t>(skill->id);
+			write_as<int16_t>(skill->rating);
+			write_as<int32_t>(skill->experience);
+			write_as<int32_t>(skill->rusty);
+		}
+	}
+
+	write<uint16_t>(u.labors.size());
+	for (bool labor: u.labors)
+		write<uint8_t>(labor);
+
+	auto occupation_count = std::min<std::size_t>(u.occupations.size(), std::numeric_limits<uint16_t>::max());
+	write<uint16_t>(occupation_count);
+	for (std::size_t i = 0; i < occupation_count; ++i)
+		write_as<int16_t>(u.occupations[i]->type);
+}
+
+} // namespace
+
+std::vector<std::unique_ptr<df::unit>> DwarfFortressReader::parseUnitRecords(std::string_view data)
+{
+	UnitRecordParser parser(data);
+	if (!data.starts_with("WDTU"))
+		throw std::runtime_error("Invalid unit record header");
+	parser.seek(4);
+	auto version = parser.read<uint16_t>();
+	if (version != UnitRecordVersion)
+		throw std::runtime_error("Unsupported unit record version " + std::to_string(version));
+	parser.read<uint16_t>(); // reserved
+	auto count = parser.read<uint32_t>();
+	std::vector<std::unique_ptr<df::unit>> units;
+	units.reserve(std::min<std::size_t>(count, data.size()));
+	for (uint32_t i = 0; i < count; ++i) {
+		auto size = parser.read<uint32_t>();
+		auto end = parser.pos() + size;
+		units.push_back(parser.parseUnit());
+		if (parser.pos() > end)
+			throw std::runtime_error("Unit record larger than its declared size");
+		parser.seek(end);
+	}
+	return units;
+}
+
+std::string DwarfFortressReader::writeUnitRecords(std::span<const std::unique_ptr<df::unit>> units)
+{
+	UnitRecordWriter writer;
+	writer.data().append("WDTU");
+	writer.write(UnitRecordVersion);
+	writer.write<uint16_t>(0); // reserved
+	writer.write<uint32_t>(units.size());
+	for (const auto &unit: units) {
+		auto size_pos = writer.data().size();
+		writer.write<uint32_t>(0);
+		writer.writeUnit(*unit);
+		writer.patch<uint32_t>(size_pos, writer.data().size() - size_pos - sizeof(uint32_t));
+	}
+	return std::move(writer.data());
+}
+
 bool DwarfFortressReader::testStructures(const Structures &structures)
 {
 	bool ok = true;
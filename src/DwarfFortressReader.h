@@ -21,6 +21,10 @@
 
 #include <dfs/Reader.h>
 
+#include <span>
+#include <string>
+#include <string_view>
+
 #include "df/time.h"
 
 namespace df {
@@ -58,8 +62,17 @@ struct DwarfFortressReader
 
 	uintptr_t getWorldDataPtr();
 	std::unique_ptr<df::world_raws> loadRaws();
-	std::unique_ptr<df_game_data> loadGameData();
+	// Units are not read when with_units is false, they can be filled
+	// with parseUnitRecords instead.
+	std::unique_ptr<df_game_data> loadGameData(bool with_units = true);
 	static bool testStructures(const dfs::Structures &structures);
+
+	// Parse units from the compact records sent by the plugin GetUnits
+	// function, throws std::runtime_error on invalid data.
+	static std::vector<std::unique_ptr<df::unit>> parseUnitRecords(std::string_view data);
+	// Encode units in the same format (used by the mock DFHack server).
+	static std::string writeUnitRecords(std::span<const std::unique_ptr<df::unit>> units);
+	static constexpr uint16_t UnitRecordVersion = 1;
 };
 
 #endif
@@ -26,6 +26,38 @@
 #include <filesystem>
 #include <charconv>
 #include <fstream>
+#include <memory>
+#include <mutex>
+
+// Last process found by scanning /proc, it is tried first on the next
+// connection if the cookie address is the same.
+static struct {
+	std::mutex mutex;
+	uint32_t pid = 0;
+	std::string comm;
+	uint64_t cookie_address = 0;
+} last_process;
+
+static std::unique_ptr<dfs::Process> makeProcess(uint32_t pid, const std::string &comm)
+{
+	if (comm == "dwarfort")
+		return std::make_unique<dfs::LinuxProcess>(pid);
+	else if (comm == "Dwarf Fortress.")
+		return std::make_unique<dfs::WineProcess>(pid);
+	else
+		return nullptr;
+}
+
+static std::optional<std::string> readComm(uint32_t pid)
+{
+	auto file = std::ifstream(std::filesystem::path("/proc") / std::to_string(pid) / "comm");
+	if (!file)
+		return std::nullopt;
+	std::string comm;
+	if (!getline(file, comm))
+		return std::nullopt;
+	return comm;
+}
 
 std::unique_ptr<dfs::Process> DwarfFortress::findNativeProcess(const dfproto::workdetailtest::ProcessInfo &info)
 {
@@ -45,6 +77,27 @@ std::unique_ptr<dfs::Process> DwarfFortress::findNativeProcess(const dfproto::wo
 	catch (std::exception &e) {
 		qCWarning(ProcessLog) << "Invalid process" << info.pid() << e.what();
 	}
+	// Try the last process found by scanning
+	{
+		std::unique_lock lock(last_process.mutex);
+		auto pid = last_process.pid;
+		auto comm = last_process.comm;
+		bool same_executable = pid != 0 && last_process.cookie_address == info.cookie_address();
+		lock.unlock();
+		if (same_executable && readComm(pid) == comm) {
+			try {
+				auto process = makeProcess(pid, comm);
+				check_cookie(*process);
+				qCInfo(ProcessLog) << "Process found using last known process" << pid << comm;
+				return process;
+			}
+			catch (std::exception &e) {
+				qCWarning(ProcessLog) << "Invalid process" << pid << e.what();
+			}
+		}
+	}
+	// Scan /proc sequentially, only processes with a matching comm value
+	// are opened. Reading comm files is cheap compared to attaching.
 	for (auto entry: std::filesystem::directory_iterator("/proc")) {
 		if (!entry.is_directory())
 			continue;
@@ -53,28 +106,26 @@ std::unique_ptr<dfs::Process> DwarfFortress::findNativeProcess(const dfproto::wo
 		auto res = std::from_chars(name.data(), name.data()+name.size(), pid);
 		if (res.ec != std::errc{} || res.ptr != name.data()+name.size())
 			continue;
-		if (auto file = std::ifstream(entry.path() / "comm")) {
-			std::string comm;
-			if (!getline(file, comm))
+		auto comm = readComm(pid);
+		if (!comm) {
+			qCWarning(ProcessLog) << "Failed to open comm file" << pid;
+			continue;
+		}
+		try {
+			auto process = makeProcess(pid, *comm);
+			if (!process)
 				continue;
-			try {
-				std::unique_ptr<dfs::Process> process;
-				if (comm == "dwarfort")
-					process = std::make_unique<dfs::LinuxProcess>(pid);
-				else if (comm == "Dwarf Fortress.")
-					process = std::make_unique<dfs::WineProcess>(pid);
-				else
-					continue;
-				check_cookie(*process);
-				qCInfo(ProcessLog) << "Process found using comm value" << info.pid() << comm;
-				return process;
-			}
-			catch (std::exception &e) {
-				qCWarning(ProcessLog) << "Invalid process" << pid << e.what();
-			}
+			check_cookie(*process);
+			qCInfo(ProcessLog) << "Process found using comm value" << pid << *comm;
+			std::lock_guard lock(last_process.mutex);
+			last_process.pid = pid;
+			last_process.comm = std::move(*comm);
+			last_process.cookie_address = info.cookie_address();
+			return process;
+		}
+		catch (std::exception &e) {
+			qCWarning(ProcessLog) << "Invalid process" << pid << e.what();
 		}
-		else
-			qCWarning(ProcessLog) << "Failed to open comm file" << pid;
 	}
 	return nullptr;
 }
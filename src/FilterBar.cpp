@@ -27,12 +27,17 @@
 #include <QWidgetAction>
 #include <QMainWindow>
 #include <QStatusBar>
+#include <QTimer>
 
 #include "Application.h"
 #include "ScriptManager.h"
 #include "UserUnitFilters.h"
 #include "Unit.h"
 
+// Delay before applying the temporary filter while typing, each change
+// restarts the delay so intermediate texts are never compiled nor evaluated.
+static constexpr std::chrono::milliseconds TemporaryFilterDelay(250);
+
 static QStatusBar *findStatusBar(QWidget *widget)
 {
 	for (; widget; widget = widget->parentWidget())
@@ -48,6 +53,7 @@ struct FilterBar::Ui
 	QWidgetAction *filter_text_action;
 	QLineEdit *filter_text;
 	QCompleter *filter_script_completer;
+	QTimer *filter_timer;
 	std::vector<std::unique_ptr<QAction>> remove_filter_actions;
 	QWidgetAction *add_filter_action;
 	QMenu *add_filter_menu;
@@ -81,6 +87,10 @@ struct FilterBar::Ui
 		filter_script_completer->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
 		filter_script_completer->setWidget(filter_text);
 
+		filter_timer = new QTimer(toolbar);
+		filter_timer->setSingleShot(true);
+		filter_timer->setInterval(TemporaryFilterDelay);
+
 		add_filter_action = new QWidgetAction(toolbar);
 		auto add_filter_button = new QToolButton;
 		add_filter_menu = new QMenu(add_filter_button);
@@ -106,6 +116,10 @@ FilterBar::FilterBar(QWidget *parent):
 		updateTemporaryFilter();
 	});
 	connect(_ui->filter_text, &QLineEdit::textChanged,
+		_ui->filter_timer, qOverload<>(&QTimer::start));
+	connect(_ui->filter_text, &QLineEdit::returnPressed,
+		this, &FilterBar::updateTemporaryFilter);
+	connect(_ui->filter_timer, &QTimer::timeout,
 		this, &FilterBar::updateTemporaryFilter);
 	connect(_ui->filter_text, &QLineEdit::textEdited,
 		this, &FilterBar::filterEditChanged);
@@ -124,8 +138,8 @@ FilterBar::FilterBar(QWidget *parent):
 		action->setData(QVariant::fromValue(data));
 		connect(action, &QAction::triggered, this, [this, action]() {
 			Q_ASSERT(_filters);
-			if (action->data().metaType() == QMetaType::fromType<QJSValue>()) {
-				_filters->addFilter(action->text(), ScriptedUnitFilter{action->data().value<QJSValue>()});
+			if (action->data().metaType() == QMetaType::fromType<UnitFilter>()) {
+				_filters->addFilter(action->text(), action->data().value<UnitFilter>());
 			}
 			else if (action->data().metaType() == QMetaType::fromType<std::size_t>()) {
 				const auto &[name, filter] = BuiltinUnitFilters[action->data().value<std::size_t>()];
@@ -161,6 +175,7 @@ void FilterBar::setFilters(std::shared_ptr<UserUnitFilters> filters)
 	// clean up old filters
 	disconnect(_inserted_signal);
 	disconnect(_removed_signal);
+	disconnect(_failed_signal);
 	_ui->remove_filter_actions.clear();
 
 	_filters = std::move(filters);
@@ -201,6 +216,17 @@ void FilterBar::filterRemoved(const QModelIndex &parent, int first, int last)
 	);
 }
 
+void FilterBar::filterFailed(const QString &name, const QString &error)
+{
+	auto status_bar = findStatusBar(this);
+	if (!status_bar)
+		return;
+	if (name.isEmpty())
+		status_bar->showMessage(tr("Script filter disabled: %1").arg(error));
+	else
+		status_bar->showMessage(tr("Filter %1 disabled: %2").arg(name).arg(error));
+}
+
 void FilterBar::setupFilters()
 {
 	// connect and setup new filters
@@ -210,6 +236,9 @@ void FilterBar::setupFilters()
 	_removed_signal = connect(
 			_filters.get(), &QAbstractItemModel::rowsAboutToBeRemoved,
 			this, &FilterBar::filterRemoved);
+	_failed_signal = connect(
+			_filters.get(), &UserUnitFilters::filterFailed,
+			this, &FilterBar::filterFailed);
 	if (_filters->rowCount() > 0)
 		insertFilterButtons(0, _filters->rowCount()-1);
 	// setup temporary filter ui
@@ -217,6 +246,7 @@ void FilterBar::setupFilters()
 	auto cb_index = _ui->filter_type_cb->findData(QVariant::fromValue(type));
 	_ui->filter_type_cb->setCurrentIndex(cb_index);
 	_ui->filter_text->setText(text);
+	_ui->filter_timer->stop(); // the text is already applied
 	updateFilterUi();
 }
 
@@ -238,6 +268,7 @@ void FilterBar::updateFilterUi()
 
 void FilterBar::updateTemporaryFilter()
 {
+	_ui->filter_timer->stop();
 	auto error = _filters->setTemporaryFilter(
 		_ui->filter_type_cb->currentData().value<UserUnitFilters::TemporaryType>(),
 		_ui->filter_text->text()
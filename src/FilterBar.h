@@ -37,6 +37,7 @@ private:
 	void insertFilterButtons(int first, int last);
 	void filterInserted(const QModelIndex &parent, int first, int last);
 	void filterRemoved(const QModelIndex &parent, int first, int last);
+	void filterFailed(const QString &name, const QString &error);
 
 	void setupFilters();
 	void updateFilterUi();
@@ -48,7 +49,7 @@ private:
 	struct Ui;
 	std::unique_ptr<Ui> _ui;
 	std::shared_ptr<UserUnitFilters> _filters;
-	QMetaObject::Connection _inserted_signal, _removed_signal;
+	QMetaObject::Connection _inserted_signal, _removed_signal, _failed_signal;
 };
 
 #endif
@@ -0,0 +1,168 @@
+/*
+ * Copyright 2024 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "GridSortModel.h"
+
+#include "GridViewModel.h"
+#include "DataRole.h"
+
+#include <algorithm>
+
+GridSortModel::GridSortModel(GridViewModel *model, QObject *parent):
+	QSortFilterProxyModel(parent),
+	_model(model)
+{
+	// Keys must be up to date before QSortFilterProxyModel handles the
+	// same signals, connect before setting the source model.
+	connect(model, &QAbstractItemModel::dataChanged,
+		this, &GridSortModel::updateKeys);
+	connect(model, &QAbstractItemModel::rowsInserted,
+		this, [this](const QModelIndex &parent) {
+			invalidateKeys();
+			checkOrder(parent);
+		});
+	connect(model, &QAbstractItemModel::rowsRemoved,
+		this, &GridSortModel::invalidateKeys);
+	connect(model, &QAbstractItemModel::columnsInserted,
+		this, &GridSortModel::invalidateKeys);
+	connect(model, &QAbstractItemModel::columnsRemoved,
+		this, &GridSortModel::invalidateKeys);
+	connect(model, &QAbstractItemModel::rowsMoved,
+		this, [this](const QModelIndex &, int, int, const QModelIndex &destination) {
+			invalidateKeys();
+			checkOrder(destination);
+		});
+	connect(model, &QAbstractItemModel::columnsMoved,
+		this, &GridSortModel::invalidateKeys);
+	connect(model, &QAbstractItemModel::layoutChanged,
+		this, &GridSortModel::invalidateKeys);
+	connect(model, &QAbstractItemModel::modelReset,
+		this, &GridSortModel::invalidateKeys);
+	setSourceModel(model);
+	setSortRole(DataRole::SortRole);
+	setDynamicSortFilter(false);
+}
+
+GridSortModel::~GridSortModel()
+{
+}
+
+bool GridSortModel::lessThan(const QModelIndex &left, const QModelIndex &right) const
+{
+	const auto &left_key = sortKey(left);
+	const auto &right_key = sortKey(right);
+	if (left_key && right_key)
+		return *left_key < *right_key;
+	else
+		return QSortFilterProxyModel::lessThan(left, right);
+}
+
+const std::optional<qint64> &GridSortModel::sortKey(const QModelIndex &index) const
+{
+	if (index.column() != _key_column) {
+		_keys.clear();
+		_key_column = index.column();
+	}
+	auto &keys = _keys[index.internalId()];
+	if (keys.empty()) {
+		auto parent = index.parent();
+		int count = _model->rowCount(parent);
+		keys.resize(count); // group rows are left without keys
+		_model->sortKeys(parent, _key_column, 0, count-1, keys);
+	}
+	Q_ASSERT(std::size_t(index.row()) < keys.size());
+	return keys[index.row()];
+}
+
+void GridSortModel::invalidateKeys()
+{
+	_keys.clear();
+	_key_column = -1;
+}
+
+void GridSortModel::updateKeys(const QModelIndex &top_left, const QModelIndex &bottom_right)
+{
+	int column = sortColumn();
+	if (column < top_left.column() || column > bottom_right.column())
+		return;
+	bool moved = true;
+	auto it = _keys.find(top_left.internalId());
+	if (column == _key_column && it != _keys.end()) {
+		int first = top_left.row();
+		int last = std::min<int>(bottom_right.row(), it->second.size()-1);
+		if (first > last)
+			return;
+		auto keys = std::span(it->second).subspan(first, last-first+1);
+		std::vector<std::optional<qint64>> new_keys(keys.size());
+		if (_model->sortKeys(top_left.parent(), column, first, last, new_keys)) {
+			// rows without keys are compared as variants and may
+			// have moved
+			moved = false;
+			for (std::size_t i = 0; i < keys.size(); ++i) {
+				if (!new_keys[i] || new_keys[i] != keys[i])
+					moved = true;
+				keys[i] = new_keys[i];
+			}
+		}
+	}
+	if (moved)
+		checkOrder(top_left.parent());
+}
+
+void GridSortModel::checkOrder(const QModelIndex &source_parent)
+{
+	if (!_unordered_parents.contains(source_parent))
+		_unordered_parents.append(source_parent);
+	if (!_order_check_queued) {
+		_order_check_queued = true;
+		QMetaObject::invokeMethod(this, &GridSortModel::updateOrder,
+				Qt::QueuedConnection);
+	}
+}
+
+bool GridSortModel::isOrdered(const QModelIndex &source_parent) const
+{
+	auto parent = mapFromSource(source_parent);
+	if (source_parent.isValid() && !parent.isValid())
+		return true; // the parent was removed
+	int column = sortColumn();
+	QModelIndex previous;
+	for (int row = 0; row < rowCount(parent); ++row) {
+		auto current = mapToSource(index(row, column, parent));
+		if (previous.isValid() && (sortOrder() == Qt::AscendingOrder
+				? lessThan(current, previous)
+				: lessThan(previous, current)))
+			return false;
+		previous = current;
+	}
+	return true;
+}
+
+void GridSortModel::updateOrder()
+{
+	_order_check_queued = false;
+	auto parents = std::move(_unordered_parents);
+	_unordered_parents.clear();
+	if (sortColumn() < 0)
+		return;
+	// Sorting is stable and persistent indexes are remapped, rows that
+	// did not move keep their selection and scroll position.
+	if (!std::ranges::all_of(parents, [this](const auto &parent) { return isOrdered(parent); }))
+		sort(sortColumn(), sortOrder());
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2024 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef GRID_SORT_MODEL_H
+#define GRID_SORT_MODEL_H
+
+#include <QSortFilterProxyModel>
+
+#include <map>
+#include <optional>
+#include <vector>
+
+class GridViewModel;
+
+// Sort proxy for GridViewModel comparing unit rows with their typed sort
+// keys (AbstractColumn::sortKey) instead of SortRole variants. Keys are
+// extracted for a whole parent at once in a contiguous array, rows without
+// an integer key (groups, names, ...) fall back to QVariant comparison.
+//
+// Dynamic sorting from QSortFilterProxyModel is replaced by an order check
+// after source changes: rows whose keys did not change are ignored and the
+// model is only sorted again when the changed rows break the current order.
+class GridSortModel: public QSortFilterProxyModel
+{
+	Q_OBJECT
+public:
+	GridSortModel(GridViewModel *model, QObject *parent = nullptr);
+	~GridSortModel() override;
+
+protected:
+	bool lessThan(const QModelIndex &left, const QModelIndex &right) const override;
+
+private:
+	GridViewModel *_model;
+	// keys for the source rows of _key_column, by parent internal id
+	mutable int _key_column = -1;
+	mutable std::map<quintptr, std::vector<std::optional<qint64>>> _keys;
+
+	const std::optional<qint64> &sortKey(const QModelIndex &index) const;
+	void invalidateKeys();
+	void updateKeys(const QModelIndex &top_left, const QModelIndex &bottom_right);
+
+	// source parents where rows may be out of order
+	QList<QPersistentModelIndex> _unordered_parents;
+	bool _order_check_queued = false;
+
+	void checkOrder(const QModelIndex &source_parent);
+	bool isOrdered(const QModelIndex &source_parent) const;
+	void updateOrder();
+};
+
+#endif
@@ -22,16 +22,17 @@
 #include <QMouseEvent>
 #include <QAbstractProxyModel>
 #include <QMenu>
+#include <QCursor>
 
 #include "GridViewModel.h"
+#include "GridSortModel.h"
 #include "GridViewStyle.h"
-#include "DataRole.h"
 
 GridView::GridView(std::unique_ptr<GridViewModel> &&model, QWidget *parent):
 	QTreeView(parent),
 	_style(std::make_unique<GridViewStyle>()),
 	_model(std::move(model)),
-	_sort_model(std::make_unique<QSortFilterProxyModel>())
+	_sort_model(std::make_unique<GridSortModel>(_model.get()))
 {
 	setStyle(_style.get());
 	header()->setStyle(_style.get());
@@ -42,11 +43,10 @@ GridView::GridView(std::unique_ptr<GridViewModel> &&model, QWidget *parent):
 	header()->setStretchLastSection(false);
 
 	Q_ASSERT(_model);
-	_sort_model->setSourceModel(_model.get());
-	_sort_model->setSortRole(DataRole::SortRole);
 	QTreeView::setModel(_sort_model.get());
 	connect(_model.get(), &QAbstractItemModel::layoutChanged, this, [this](const QList<QPersistentModelIndex> &parents, QAbstractItemModel::LayoutChangeHint hint) {
-		if (hint == QAbstractItemModel::NoLayoutChangeHint) { // ignore sorting changes
+		// ignore sorting changes, only groups need to be expanded
+		if (hint == QAbstractItemModel::NoLayoutChangeHint && _model->hasGroups()) {
 			if (!parents.empty()) {
 				for(auto parent: parents)
 					expandRecursively(parent);
@@ -61,7 +61,26 @@ GridView::GridView(std::unique_ptr<GridViewModel> &&model, QWidget *parent):
 			2*_style->pixelMetric(QStyle::PM_HeaderMargin, nullptr, header())
 			+ _style->pixelMetric(QStyle::PM_SmallIconSize, nullptr, header()));
 	header()->setSectionResizeMode(QHeaderView::Fixed);
-	header()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
+	// The name column is resized only when its content may have changed,
+	// ResizeToContents would measure it on every geometry update.
+	_name_column_timer.setSingleShot(true);
+	connect(&_name_column_timer, &QTimer::timeout,
+		this, [this]() { resizeColumnToContents(0); });
+	auto resize_name_column = qOverload<>(&QTimer::start);
+	connect(_sort_model.get(), &QAbstractItemModel::modelReset,
+		&_name_column_timer, resize_name_column);
+	connect(_sort_model.get(), &QAbstractItemModel::layoutChanged,
+		&_name_column_timer, resize_name_column);
+	connect(_sort_model.get(), &QAbstractItemModel::rowsInserted,
+		&_name_column_timer, resize_name_column);
+	connect(_sort_model.get(), &QAbstractItemModel::rowsRemoved,
+		&_name_column_timer, resize_name_column);
+	connect(_sort_model.get(), &QAbstractItemModel::dataChanged,
+		this, [this](const QModelIndex &top_left) {
+			if (top_left.column() == 0)
+				_name_column_timer.start();
+		});
+	_name_column_timer.start();
 
 	header()->setContextMenuPolicy(Qt::CustomContextMenu);
 	connect(header(), &QWidget::customContextMenuRequested, this, [this](const QPoint &pos) {
@@ -117,11 +136,89 @@ QItemSelection GridView::mapSelectionFromSource(const QItemSelection &selection)
 void GridView::rowsInserted(const QModelIndex &index, int start, int end)
 {
 	QTreeView::rowsInserted(index, start, end);
-	if (model())
+	// Only top-level groups have children
+	if (model() && _model->hasGroups() && !index.isValid())
 		for (int i = start; i <= end; ++i)
 			expand(model()->index(i, 0, index));
 }
 
+void GridView::drawRow(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+	auto source = _sort_model->mapToSource(index);
+	auto selection = selectionModel();
+	auto hover = underMouse()
+		? indexAt(viewport()->mapFromGlobal(QCursor::pos()))
+		: QModelIndex{};
+	auto cell_rect = [&](int column) {
+		return QRect(header()->sectionViewportPosition(column),
+				option.rect.y(),
+				header()->sectionSize(column),
+				option.rect.height());
+	};
+
+	// Visible sections in visual order
+	int first_visual = header()->visualIndexAt(0);
+	int last_visual = header()->visualIndexAt(viewport()->width()-1);
+	if (first_visual < 0)
+		return;
+	if (last_visual < 0)
+		last_visual = header()->count()-1;
+	std::vector<int> columns;
+	for (int visual = first_visual; visual <= last_visual; ++visual) {
+		int column = header()->logicalIndex(visual);
+		if (header()->isSectionHidden(column))
+			continue;
+		if (column != 0) {
+			columns.push_back(column);
+			continue;
+		}
+		// Name column, with the tree branches
+		auto name_index = index.siblingAtColumn(0);
+		auto name_option = option;
+		name_option.rect = cell_rect(0);
+		int indent = indentation() * ((index.parent().isValid() ? 1 : 0) + (rootIsDecorated() ? 1 : 0));
+		if (indent > 0) {
+			drawBranches(painter,
+					QRect(name_option.rect.x(), name_option.rect.y(), indent, name_option.rect.height()),
+					index);
+			name_option.rect.setLeft(name_option.rect.left() + indent);
+		}
+		if (selection->isSelected(name_index))
+			name_option.state |= QStyle::State_Selected;
+		if (name_index == hover)
+			name_option.state |= QStyle::State_MouseOver;
+		if (hasFocus() && name_index == currentIndex())
+			name_option.state |= QStyle::State_HasFocus;
+		itemDelegateForIndex(name_index)->paint(painter, name_option, name_index);
+	}
+	if (columns.empty())
+		return;
+
+	// Grid cells are fetched by runs of consecutive columns (all of them
+	// unless sections were moved or hidden)
+	std::vector<AbstractColumn::CellState> states(columns.size());
+	for (std::size_t first = 0; first < columns.size();) {
+		auto last = first;
+		while (last+1 < columns.size() && columns[last+1] == columns[last]+1)
+			++last;
+		_model->rowCellStates(source, columns[first], columns[last],
+				std::span(states).subspan(first, last-first+1));
+		first = last+1;
+	}
+	std::vector<GridViewStyle::Cell> cells;
+	cells.reserve(columns.size());
+	for (std::size_t i = 0; i < columns.size(); ++i) {
+		auto cell_index = index.siblingAtColumn(columns[i]);
+		cells.push_back({
+			.rect = cell_rect(columns[i]),
+			.state = &states[i],
+			.selected = selection->isSelected(cell_index),
+			.hovered = cell_index == hover,
+		});
+	}
+	_style->drawCells(option, cells, painter, this);
+}
+
 void GridView::toggleCells(const QModelIndex &index)
 {
 	auto selection = selectionModel();
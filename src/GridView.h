@@ -20,11 +20,13 @@
 #define GRID_VIEW_H
 
 #include <QTreeView>
+#include <QTimer>
 
 class GridViewModel;
+class GridViewStyle;
 class QSortFilterProxyModel;
 
-// GridView uses a GridViewModel and a QSortFilterProxyModel for sorting, index
+// GridView uses a GridViewModel and a GridSortModel for sorting, index
 // from QTreeView will be indexes from the sort model and must be mapped before
 // used with the GridViewModel.
 class GridView: public QTreeView
@@ -50,6 +52,9 @@ signals:
 
 protected:
 	void rowsInserted(const QModelIndex &index, int start, int end) override;
+	// Only the visible cells are painted, grid cells are fetched with
+	// GridViewModel::rowCellStates and painted by GridViewStyle::drawCells
+	void drawRow(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
 
 	// For cell painting
 	void mousePressEvent(QMouseEvent *event) override;
@@ -57,10 +62,11 @@ protected:
 	void mouseMoveEvent(QMouseEvent *event) override;
 
 private:
-	std::unique_ptr<QStyle> _style;
+	std::unique_ptr<GridViewStyle> _style;
 	std::unique_ptr<GridViewModel> _model;
 	std::unique_ptr<QSortFilterProxyModel> _sort_model;
 	QPersistentModelIndex _last_index; // only valid when cell painting
+	QTimer _name_column_timer;
 
 	void toggleCells(const QModelIndex &index);
 };
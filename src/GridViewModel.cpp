@@ -55,11 +55,12 @@ GridViewModel::Parameters GridViewModel::Parameters::fromJson(const QJsonDocumen
 				params.filter = filter->second;
 		}
 		else if (type == "script") {
-			auto filter = Application::scripts().makeScript(value);
-			if (filter.isError())
-				qCCritical(GridViewLog) << "Invalid script filter:" << filter.property("message").toString();
+			QString error;
+			auto filter = Application::scripts().makeFilter(value, &error);
+			if (!filter)
+				qCCritical(GridViewLog) << "Invalid script filter:" << error;
 			else
-				params.filter = ScriptedUnitFilter{filter};
+				params.filter = std::move(filter);
 		}
 		else
 			qCCritical(GridViewLog) << "Unsupported filter type:" << type;
@@ -241,7 +242,7 @@ QVariant GridViewModel::data(const QModelIndex &index, int role) const
 		},
 		[this, role](const group_t &group, int column) -> QVariant {
 			auto [col, section] = getColumn(column);
-			return col->groupData(section, {_group_by.get(), group.id}, as_const_span(group.units), role);
+			return col->groupData(section, {_group_by.get(), group.id}, as_const_span(group.units), group.aggregates[column], role);
 		});
 }
 
@@ -267,7 +268,7 @@ Qt::ItemFlags GridViewModel::flags(const QModelIndex &index) const
 		},
 		[this](const group_t &group, int column) -> Qt::ItemFlags {
 			auto [col, section] = getColumn(column);
-			return col->groupFlags(section, as_const_span(group.units));
+			return col->groupFlags(section, as_const_span(group.units), group.aggregates[column]);
 		}) | Qt::ItemIsSelectable;
 }
 
@@ -286,6 +287,49 @@ const Unit *GridViewModel::unit(const QModelIndex &index) const
 		return _unit_filter.get(index.row());
 }
 
+void GridViewModel::rowCellStates(const QModelIndex &index, int first, int last, std::span<AbstractColumn::CellState> states) const
+{
+	Q_ASSERT(states.size() == std::size_t(last-first+1));
+	applyToIndex(*this, index,
+		[&, this](const Unit &unit, int) {
+			for (int column = first; column <= last;) {
+				auto [col, section] = getColumn(column);
+				int end = std::min(last+1, col->end_column);
+				for (; column < end; ++column, ++section)
+					states[column-first] = col->cellState(section, unit);
+			}
+		},
+		[&, this](const group_t &group, int) {
+			for (int column = first; column <= last;) {
+				auto [col, section] = getColumn(column);
+				int end = std::min(last+1, col->end_column);
+				for (; column < end; ++column, ++section)
+					states[column-first] = col->groupCellState(section,
+							{_group_by.get(), group.id},
+							as_const_span(group.units),
+							group.aggregates[column]);
+			}
+		});
+}
+
+bool GridViewModel::sortKeys(const QModelIndex &parent, int column, int first, int last, std::span<std::optional<qint64>> keys) const
+{
+	Q_ASSERT(keys.size() == std::size_t(last-first+1));
+	auto [col, section] = getColumn(column);
+	if (_group_by) {
+		if (!parent.isValid()) // groups
+			return false;
+		const auto &units = _groups[parent.row()].units;
+		for (int row = first; row <= last; ++row)
+			keys[row-first] = col->sortKey(section, *units[row]);
+	}
+	else {
+		for (int row = first; row <= last; ++row)
+			keys[row-first] = col->sortKey(section, *_unit_filter.get(row));
+	}
+	return true;
+}
+
 QModelIndex GridViewModel::mapToSource(const QModelIndex &index) const
 {
 	if (!index.isValid())
@@ -412,6 +456,7 @@ void GridViewModel::toggleCells(const QModelIndexList &indexes)
 				auto state = col->groupData(sec,
 						{_group_by.get(), g->id},
 						as_const_span(g->units),
+						g->aggregates[i],
 						Qt::CheckStateRole).value<Qt::CheckState>();
 				col->setGroupData(sec,
 						g->units,
@@ -428,6 +473,7 @@ void GridViewModel::toggleCells(const QModelIndexList &indexes)
 
 void GridViewModel::setGroupBy(int index)
 {
+	flushDataChanged();
 	layoutAboutToBeChanged();
 	// Keep the unit id for each persistent index (or -1 for groups)
 	QModelIndexList old_indexes = persistentIndexList();
@@ -480,7 +526,7 @@ void GridViewModel::cellDataChanged(int first, int last, const QItemSelection &u
 	}
 	else {
 		for (const auto &range: optimizeSelection(filtered_units.indexes()))
-			dataChanged(
+			markDataChanged(
 				createIndex(range.top(), col->begin_column+first, NoParent),
 				createIndex(range.bottom(), col->begin_column+last, NoParent));
 	}
@@ -488,18 +534,34 @@ void GridViewModel::cellDataChanged(int first, int last, const QItemSelection &u
 
 void GridViewModel::unitDataChanged(const QModelIndex &first, const QModelIndex &last, const QList<int> &roles)
 {
+	// Only update the columns depending on the changed unit fields
+	Unit::Changes changes = 0;
+	for (int row = first.row(); row <= last.row(); ++row)
+		changes |= _unit_filter.get(row)->lastChanges();
+	int first_col = columnCount(), last_col = -1;
+	for (const auto &col: _columns)
+		if ((col->unitDependencies() & changes) && col->begin_column != col->end_column) {
+			first_col = std::min(first_col, col->begin_column);
+			last_col = std::max(last_col, col->end_column-1);
+		}
+	if (first_col > last_col) { // no column is affected
+		if (!_group_by)
+			return;
+		first_col = last_col = 0; // but the group may change
+	}
 	if (_group_by) {
-		updateGroupedUnit({first, last}, 0, columnCount()-1);
+		updateGroupedUnit({first, last}, first_col, last_col);
 	}
 	else {
-		dataChanged(
-			index(first.row(), 0),
-			index(last.row(), columnCount()-1));
+		markDataChanged(
+			index(first.row(), first_col),
+			index(last.row(), last_col));
 	}
 }
 
 void GridViewModel::unitBeginInsert(const QModelIndex &, int first, int last)
 {
+	flushDataChanged();
 	if (!_group_by)
 		beginInsertRows({}, first, last);
 }
@@ -518,6 +580,7 @@ void GridViewModel::unitEndInsert(const QModelIndex &, int first, int last)
 
 void GridViewModel::unitBeginRemove(const QModelIndex &, int first, int last)
 {
+	flushDataChanged();
 	if (_group_by) {
 		for (int unit_index = first; unit_index <= last; ++unit_index) {
 			auto &unit = *_unit_filter.get(unit_index);
@@ -570,9 +633,11 @@ void GridViewModel::addUnitToGroup(Unit &unit, quint64 group_id, bool reseting)
 		// Add new group
 		if (!reseting) {
 			auto row = distance(_groups.begin(), new_group_it);
+			flushDataChanged();
 			beginInsertRows({}, row, row);
 		}
-		_groups.insert(new_group_it, {group_id, {&unit}});
+		new_group_it = _groups.insert(new_group_it, {group_id, {&unit}});
+		addUnitAggregates(*new_group_it, unit);
 		if (!reseting)
 			endInsertRows();
 	}
@@ -583,12 +648,14 @@ void GridViewModel::addUnitToGroup(Unit &unit, quint64 group_id, bool reseting)
 		auto group_index = groupIndex(new_group_it);
 		if (!reseting) {
 			auto row = distance(new_group_it->units.begin(), insert_pos);
+			flushDataChanged();
 			beginInsertRows(group_index, row, row);
 		}
 		new_group_it->units.insert(insert_pos, &unit);
+		addUnitAggregates(*new_group_it, unit);
 		if (!reseting) {
 			endInsertRows();
-			dataChanged(
+			markDataChanged(
 				group_index.siblingAtColumn(0),
 				group_index.siblingAtColumn(columnCount()-1));
 		}
@@ -599,17 +666,20 @@ void GridViewModel::removeFromGroup(const QModelIndex &index)
 {
 	auto group = findGroup(index.internalId());
 	auto group_index = groupIndex(group);
+	removeUnitAggregates(*group, *group->units[index.row()]);
 	if (group->units.size() == 1) {
 		// Last unit in the group, remove the whole group
+		flushDataChanged();
 		beginRemoveRows({}, group_index.row(), group_index.row());
 		_groups.erase(group);
 		endRemoveRows();
 	}
 	else {
+		flushDataChanged();
 		beginRemoveRows(index.parent(), index.row(), index.row());
 		group->units.erase(next(group->units.begin(), index.row()));
 		endRemoveRows();
-		dataChanged(
+		markDataChanged(
 			group_index.siblingAtColumn(0),
 			group_index.siblingAtColumn(columnCount()-1));
 	}
@@ -657,15 +727,17 @@ void GridViewModel::updateGroupedUnit(const QItemSelection &units, int first_col
 				moveGroupedUnitRange(group_index, new_group_id, units);
 			}
 			else { // group has not changed, only update data
+				for (auto unit: units)
+					updateUnitAggregates(*group_it, *unit, first_col, last_col);
 				QModelIndex parent = group_index;
-				dataChanged(
+				markDataChanged(
 					index(distance(group_it->units.begin(), units.begin()),
 						first_col,
 						parent),
 					index(distance(group_it->units.begin(), units.end())-1,
 						last_col,
 						parent));
-				dataChanged(
+				markDataChanged(
 					parent.siblingAtColumn(first_col),
 					parent.siblingAtColumn(last_col));
 			}
@@ -682,6 +754,7 @@ void GridViewModel::moveGroupedUnitRange(const QPersistentModelIndex &old_group_
 	QModelIndex new_group_index = groupIndex(new_group_it);
 	if (new_group_it == _groups.end() || new_group_it->id != new_group_id) {
 		// Add new group
+		flushDataChanged();
 		beginInsertRows({}, new_group_index.row(), new_group_index.row());
 		new_group_it = _groups.insert(new_group_it, {new_group_id, {}});
 		endInsertRows();
@@ -698,30 +771,35 @@ void GridViewModel::moveGroupedUnitRange(const QPersistentModelIndex &old_group_
 	Q_ASSERT(insert_pos == new_group_it->units.end() ||
 			get_id(units.back()) < get_id(*insert_pos));
 	// Move rows
+	flushDataChanged();
 	beginMoveRows(old_group_index,
 			distance(old_group_it->units.begin(), units.begin()),
 			distance(old_group_it->units.begin(), units.end())-1,
 			new_group_index,
 			insert_row);
-	for (auto unit: units)
+	for (auto unit: units) {
 		_unit_group[(*unit)->id] = new_group_id;
+		removeUnitAggregates(*old_group_it, *unit);
+		addUnitAggregates(*new_group_it, *unit);
+	}
 	new_group_it->units.insert(insert_pos, units.begin(), units.end());
 	old_group_it->units.erase(units.begin(), units.end());
 	endMoveRows();
 
 	// Update new group
-	dataChanged(
+	markDataChanged(
 		new_group_index.siblingAtColumn(0),
 		new_group_index.siblingAtColumn(columnCount()-1));
 	if (old_group_it->units.size() == 0) {
 		// Remove empty old group
+		flushDataChanged();
 		beginRemoveRows({}, old_group_index.row(), old_group_index.row());
 		_groups.erase(old_group_it);
 		endRemoveRows();
 	}
 	else {
 		// Update old group
-		dataChanged(
+		markDataChanged(
 			QModelIndex(old_group_index).siblingAtColumn(0),
 			QModelIndex(old_group_index).siblingAtColumn(columnCount()-1));
 	}
@@ -731,6 +809,7 @@ void GridViewModel::rebuildGroups()
 {
 	_groups.clear();
 	_unit_group.clear();
+	_unit_cell_states.clear();
 	if (_group_by)
 		for (int unit_index = 0; unit_index < _unit_filter.rowCount(); ++unit_index) {
 			auto &unit = *_unit_filter.get(unit_index);
@@ -738,22 +817,124 @@ void GridViewModel::rebuildGroups()
 		}
 }
 
+void GridViewModel::markDataChanged(const QModelIndex &top_left, const QModelIndex &bottom_right)
+{
+	Q_ASSERT(top_left.internalId() == bottom_right.internalId());
+	QRect rect(QPoint(top_left.column(), top_left.row()),
+			QPoint(bottom_right.column(), bottom_right.row()));
+	auto [it, inserted] = _dirty.try_emplace(top_left.internalId(), rect);
+	if (!inserted)
+		it->second |= rect;
+	if (!_flush_queued) {
+		_flush_queued = true;
+		QMetaObject::invokeMethod(this, [this]() {
+			_flush_queued = false;
+			flushDataChanged();
+		}, Qt::QueuedConnection);
+	}
+}
+
+void GridViewModel::flushDataChanged()
+{
+	auto dirty = std::move(_dirty);
+	_dirty.clear();
+	for (const auto &[parent_id, rect]: dirty) {
+		if (parent_id != NoParent) {
+			auto it = std::ranges::lower_bound(_groups, parent_id, {}, &group_t::id);
+			if (it == _groups.end() || it->id != parent_id)
+				continue; // the group was removed
+		}
+		dataChanged(createIndex(rect.top(), rect.left(), parent_id),
+				createIndex(rect.bottom(), rect.right(), parent_id));
+	}
+}
+
+uint8_t GridViewModel::unitCellState(const Unit &unit, int column) const
+{
+	auto [col, section] = getColumn(column);
+	uint8_t state = 0;
+	if (col->unitData(section, unit, Qt::CheckStateRole).value<Qt::CheckState>() == Qt::Checked)
+		state |= Checked;
+	if (col->unitFlags(section, unit) & Qt::ItemIsUserCheckable)
+		state |= Checkable;
+	return state;
+}
+
+void GridViewModel::addCellState(AbstractColumn::GroupAggregate &aggregate, uint8_t state, int sign)
+{
+	if (state & Checked)
+		aggregate.checked += sign;
+	if (state & Checkable)
+		aggregate.checkable += sign;
+}
+
+void GridViewModel::addUnitAggregates(group_t &group, const Unit &unit)
+{
+	int columns = columnCount();
+	group.aggregates.resize(columns);
+	auto &states = _unit_cell_states[unit->id];
+	states.resize(columns);
+	for (int i = 0; i < columns; ++i) {
+		states[i] = unitCellState(unit, i);
+		addCellState(group.aggregates[i], states[i], 1);
+	}
+}
+
+void GridViewModel::removeUnitAggregates(group_t &group, const Unit &unit)
+{
+	auto it = _unit_cell_states.find(unit->id);
+	if (it == _unit_cell_states.end())
+		return;
+	for (std::size_t i = 0; i < it->second.size() && i < group.aggregates.size(); ++i)
+		addCellState(group.aggregates[i], it->second[i], -1);
+	_unit_cell_states.erase(it);
+}
+
+void GridViewModel::updateUnitAggregates(group_t &group, const Unit &unit, int first_col, int last_col)
+{
+	auto &states = _unit_cell_states[unit->id];
+	Q_ASSERT(states.size() == group.aggregates.size());
+	for (int i = first_col; i <= last_col; ++i) {
+		auto state = unitCellState(unit, i);
+		if (state != states[i]) {
+			addCellState(group.aggregates[i], states[i], -1);
+			addCellState(group.aggregates[i], state, 1);
+			states[i] = state;
+		}
+	}
+}
+
+void GridViewModel::rebuildAggregates()
+{
+	_unit_cell_states.clear();
+	for (auto &group: _groups) {
+		group.aggregates.clear();
+		for (auto unit: group.units)
+			addUnitAggregates(group, *unit);
+	}
+}
+
 void GridViewModel::columnDataChanged(int first, int last)
 {
 	auto col = qobject_cast<AbstractColumn *>(sender());
 	Q_ASSERT(col);
+	for (auto &group: _groups)
+		for (auto unit: group.units)
+			updateUnitAggregates(group, *unit, col->begin_column+first, col->begin_column+last);
 	headerDataChanged(Qt::Horizontal, col->begin_column+first, col->begin_column+last);
-	dataChanged(
-		index(0, col->begin_column+first),
-		index(rowCount(), col->begin_column+last)
-	);
+	if (int count = rowCount(); count > 0)
+		markDataChanged(
+			index(0, col->begin_column+first),
+			index(count-1, col->begin_column+last)
+		);
 	if (_group_by) {
 		for (std::size_t i = 0; i < _groups.size(); ++i) {
 			auto group = index(i, 0);
-			dataChanged(
-				index(0, col->begin_column+first, group),
-				index(rowCount(group), col->begin_column+last, group)
-			);
+			if (int count = rowCount(group); count > 0)
+				markDataChanged(
+					index(0, col->begin_column+first, group),
+					index(count-1, col->begin_column+last, group)
+				);
 		}
 	}
 }
@@ -763,6 +944,7 @@ void GridViewModel::columnBeginInsert(int first, int last)
 	auto col = qobject_cast<AbstractColumn *>(sender());
 	Q_ASSERT(col);
 	auto offset = col->begin_column;
+	flushDataChanged();
 	beginInsertColumns({}, offset+first, offset+last);
 	if (_group_by)
 		for (std::size_t i = 0; i < _groups.size(); ++i)
@@ -779,6 +961,7 @@ void GridViewModel::columnBeginInsert(int first, int last)
 
 void GridViewModel::columnEndInsert(int first, int last)
 {
+	rebuildAggregates();
 	endInsertColumns();
 	if (_group_by)
 		for (std::size_t i = 0; i < _groups.size(); ++i)
@@ -790,6 +973,7 @@ void GridViewModel::columnBeginRemove(int first, int last)
 	auto col = qobject_cast<AbstractColumn *>(sender());
 	Q_ASSERT(col);
 	auto offset = col->begin_column;
+	flushDataChanged();
 	beginRemoveColumns({}, offset+first, offset+last);
 	if (_group_by)
 		for (std::size_t i = 0; i < _groups.size(); ++i)
@@ -806,6 +990,7 @@ void GridViewModel::columnBeginRemove(int first, int last)
 
 void GridViewModel::columnEndRemove(int first, int last)
 {
+	rebuildAggregates();
 	endRemoveColumns();
 	if (_group_by)
 		for (std::size_t i = 0; i < _groups.size(); ++i)
@@ -817,6 +1002,7 @@ void GridViewModel::columnBeginMove(int first, int last, int dest)
 	auto col = qobject_cast<AbstractColumn *>(sender());
 	Q_ASSERT(col);
 	auto offset = col->begin_column;
+	flushDataChanged();
 	beginMoveColumns({}, offset+first, offset+last, {}, offset+dest);
 	if (_group_by)
 		for (std::size_t i = 0; i < _groups.size(); ++i) {
@@ -827,6 +1013,7 @@ void GridViewModel::columnBeginMove(int first, int last, int dest)
 
 void GridViewModel::columnEndMove(int first, int last, int dest)
 {
+	rebuildAggregates();
 	endMoveColumns();
 	if (_group_by)
 		for (std::size_t i = 0; i < _groups.size(); ++i)
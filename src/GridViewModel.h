@@ -20,13 +20,14 @@
 #define GRID_VIEW_MODEL_H
 
 #include <QAbstractItemModel>
+#include <QRect>
 
 #include "UnitFilterProxyModel.h"
+#include "AbstractColumn.h"
 #include "Columns/Factory.h"
 
 class QMenu;
 class DwarfFortressData;
-class AbstractColumn;
 class GroupBy;
 class Unit;
 
@@ -51,6 +52,7 @@ public:
 
 	void setGroupBy(int index);
 	int groupIndex() const { return _group_index; }
+	bool hasGroups() const { return bool(_group_by); }
 
 	QModelIndex index(int row, int column, const QModelIndex &parent = {}) const override;
 	QModelIndex parent(const QModelIndex &index) const override;
@@ -64,6 +66,13 @@ public:
 
 	const Unit *unit(const QModelIndex &index) const;
 
+	// Fill states with the cells from columns first to last in the row of
+	// index, unit or group.
+	void rowCellStates(const QModelIndex &index, int first, int last, std::span<AbstractColumn::CellState> states) const;
+	// Fill keys with AbstractColumn::sortKey for rows first to last in column
+	// under parent. Returns false if the rows are groups.
+	bool sortKeys(const QModelIndex &parent, int column, int first, int last, std::span<std::optional<qint64>> keys) const;
+
 	QModelIndex mapToSource(const QModelIndex &index) const;
 	QItemSelection mapSelectionToSource(const QItemSelection &selection) const;
 	QModelIndex mapFromSource(const QModelIndex &index) const;
@@ -107,10 +116,20 @@ private:
 	struct group_t {
 		quint64 id;
 		std::vector<Unit *> units; // sorted by id
+		std::vector<AbstractColumn::GroupAggregate> aggregates; // for each column
 		decltype(units)::const_iterator findUnit(int id) const;
 	};
 	std::vector<group_t> _groups; // sorted by id
 	std::map<int, quint64> _unit_group; // unit id -> group id
+	enum CellFlag: uint8_t {
+		Checked = 1,
+		Checkable = 2,
+	};
+	std::map<int, std::vector<uint8_t>> _unit_cell_states; // unit id -> CellFlag for each column
+	// Pending dataChanged, merged for each parent internal id (rect x are
+	// columns, y are rows)
+	std::map<quintptr, QRect> _dirty;
+	bool _flush_queued = false;
 	auto findGroup(quint64 id) {
 		auto it = std::ranges::lower_bound(_groups, id, {}, &group_t::id);
 		Q_ASSERT(it != _groups.end() && it->id == id);
@@ -129,6 +148,16 @@ private:
 	void updateGroupedUnit(const QItemSelection &units, int first_col, int last_col);
 	void moveGroupedUnitRange(const QPersistentModelIndex &old_group_index, quint64 new_group_id, std::ranges::subrange<decltype(group_t::units)::iterator> units);
 	void rebuildGroups();
+	uint8_t unitCellState(const Unit &unit, int column) const;
+	static void addCellState(AbstractColumn::GroupAggregate &aggregate, uint8_t state, int sign);
+	void addUnitAggregates(group_t &group, const Unit &unit);
+	void removeUnitAggregates(group_t &group, const Unit &unit);
+	void updateUnitAggregates(group_t &group, const Unit &unit, int first_col, int last_col);
+	void rebuildAggregates();
+	// dataChanged is coalesced and emitted once per event loop iteration,
+	// pending changes must be flushed before any row or column change.
+	void markDataChanged(const QModelIndex &top_left, const QModelIndex &bottom_right);
+	void flushDataChanged();
 
 	template <typename Model, typename UnitAction, typename GroupAction, typename... Args>
 	static auto applyToIndex(Model &&model, const QModelIndex &index, UnitAction &&unit_action, GroupAction &&group_action, Args &&...args);
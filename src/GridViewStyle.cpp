@@ -21,7 +21,6 @@
 #include <QStyleOptionHeader>
 #include "Application.h"
 #include "PainterSaver.h"
-#include "DataRole.h"
 
 static constexpr int ItemMargin = 3;
 static constexpr int ItemBorder = 2;
@@ -41,12 +40,20 @@ static QColor mix(const QColor &a, const QColor &b)
 	};
 }
 
-static void drawBorder(QPainter *painter, const QRect &rect, const QPen &pen)
+static QPalette::ColorGroup colorGroup(const QStyleOption &option, const QWidget *widget)
+{
+	if (widget ? !widget->isEnabled() : !(option.state & QStyle::State_Enabled))
+		return QPalette::Disabled;
+	return option.state & QStyle::State_Active ? QPalette::Normal : QPalette::Inactive;
+}
+
+static void drawHover(QPainter *painter, const QRect &rect, const QColor &highlight, const QColor &text)
 {
 	PainterSaver ps(*painter);
-	painter->setBrush(Qt::NoBrush);
-	painter->setPen(pen);
-	painter->drawRect(rect);
+	painter->fillRect(rect, withAlpha(highlight, 50));
+	painter->setPen(mix(highlight, text));
+	painter->drawLine(rect.topLeft(), rect.topRight());
+	painter->drawLine(rect.bottomLeft(), rect.bottomRight());
 }
 
 GridViewStyle::GridViewStyle(QStyle *style):
@@ -109,109 +116,265 @@ void GridViewStyle::drawControl(ControlElement element, const QStyleOption *opti
 				subopt.rect = rotated(subopt.rect);
 				subopt.icon = {};
 
-				baseStyle()->drawControl(CE_HeaderLabel, &subopt, painter, widget);
+				// Rotated labels are rendered once in a pixmap
+				header_key_t key = {
+					.section = header->section,
+					.text = header->text,
+					.size = subopt.rect.size(),
+					.dpr = painter->device()->devicePixelRatioF(),
+					.font = painter->font(),
+					.color = header->palette.color(QPalette::ButtonText).rgba(),
+					.state = int(header->state),
+				};
+				auto it = _headers.find(key);
+				if (it == _headers.end()) {
+					if (_headers.size() >= MaxCachedHeaders)
+						_headers.clear();
+					QPixmap label(subopt.rect.size() * key.dpr);
+					label.setDevicePixelRatio(key.dpr);
+					label.fill(Qt::transparent);
+					QPainter label_painter(&label);
+					label_painter.setFont(painter->font());
+					auto label_opt = subopt;
+					label_opt.rect.moveTopLeft({0, 0});
+					baseStyle()->drawControl(CE_HeaderLabel, &label_opt, &label_painter, widget);
+					it = _headers.insert(key, label);
+				}
+				painter->drawPixmap(subopt.rect.topLeft(), *it);
 			}
 			return;
 		}
 		break;
-	case CE_ItemViewItem:
-		if (auto item = qstyleoption_cast<const QStyleOptionViewItem *>(option)) {
-			if (item->index.column() == 0)
-				break;
-			// Panel
-			proxy()->drawPrimitive(QStyle::PE_PanelItemViewItem, item, painter);
-			// Check indicator
-			auto text_role = QPalette::Text;
-			if (item->features & QStyleOptionViewItem::HasCheckIndicator) {
-				switch (item->checkState) {
-				case Qt::Checked:
-					painter->fillRect(
-							option->rect.adjusted(ItemMargin, ItemMargin, -ItemMargin, -ItemMargin),
-							option->palette.text());
-					text_role = QPalette::Base;
-					break;
-				case Qt::PartiallyChecked:
-					painter->drawRect(option->rect.adjusted(ItemMargin, ItemMargin, -ItemMargin-1, -ItemMargin-1));
-
-					break;
-				default:
-					break;
-				}
-			}
+	default:
+		break;
+	}
+	baseStyle()->drawControl(element, option, painter, widget);
+}
 
-			auto rating_data = item->index.data(DataRole::RatingRole);
-			if (!rating_data.isNull()) {
-				auto rating = rating_data.toDouble();
-				QPalette palette = option->palette;
-				if (rating < 0.0)
-					palette.setColor(text_role, Qt::red);
-				PainterSaver ps(*painter);
-				switch (Application::settings().rating_display_mode()) {
-				case RatingDisplay::GrowingBox:
-					painter->setPen(Qt::NoPen);
-					painter->setBrush(palette.color(text_role));
-
-					rating = std::abs(rating);
-					if (rating >= 1.0) {
-						// Draw diamond
-						int size = std::min(option->rect.width(), option->rect.height()) - 2*ItemMargin;
-						painter->setRenderHint(QPainter::Antialiasing);
-						auto center = option->rect.toRectF().center();
-						painter->drawPolygon(QList<QPointF>{
-								center + QPointF{0.0, -size/2.0},
-								center + QPointF{size/3.0, 0.0},
-								center + QPointF{0.0, size/2.0},
-								center + QPointF{-size/3.0, 0.0},
-								});
-					}
-					else if (rating >= 0.05) {
-						// Draw square proportional to rating
-						int size = (std::min(option->rect.width(), option->rect.height()) - 3*ItemMargin) * rating + 0.5;
-						painter->drawRect(option->rect.adjusted(
-								(option->rect.width()-size+1)/2,
-								(option->rect.height()-size+1)/2,
-								-(option->rect.width()-size+1)/2,
-								-(option->rect.height()-size+1)/2));
-					}
-					break;
-				case RatingDisplay::Text:
-					painter->setFont(item->font);
-					proxy()->drawItemText(painter, option->rect, Qt::AlignCenter,
-							palette, option->state & QStyle::State_Enabled,
-							item->text, text_role);
-					break;
-				}
+static int ratingShape(const QRect &rect, std::optional<double> rating)
+{
+	if (!rating || Application::settings().rating_display_mode() != RatingDisplay::GrowingBox)
+		return 0;
+	auto value = std::abs(*rating);
+	if (value >= 1.0)
+		return -1; // diamond
+	else if (value >= 0.05)
+		return (std::min(rect.width(), rect.height()) - 3*ItemMargin) * value + 0.5;
+	else
+		return 0;
+}
+
+void GridViewStyle::drawCachedContent(const QStyleOptionViewItem &item, std::optional<double> cell_rating, const QBrush &border, QPainter *painter) const
+{
+	// Cell content is blitted from a cached pixmap unless it contains text
+	int shape = ratingShape(item.rect, cell_rating);
+	bool has_text = !item.text.isEmpty()
+		&& !(cell_rating && Application::settings().rating_display_mode() == RatingDisplay::GrowingBox);
+	if (has_text || (border.style() != Qt::NoBrush && border.style() != Qt::SolidPattern)) {
+		drawCellContent(item, cell_rating, border, painter);
+		return;
+	}
+	glyph_key_t key = {
+		.size = item.rect.size(),
+		.dpr = painter->device()->devicePixelRatioF(),
+		.shape = shape,
+		.check = item.features & QStyleOptionViewItem::HasCheckIndicator
+			? int(item.checkState)
+			: -1,
+		.negative = cell_rating && *cell_rating < 0.0,
+		.enabled = item.state.testFlag(QStyle::State_Enabled),
+		.text = item.palette.color(QPalette::Text).rgba(),
+		.base = item.palette.color(QPalette::Base).rgba(),
+		.pen = painter->pen().color().rgba(),
+		.border = border.style() == Qt::NoBrush ? 0 : border.color().rgba(),
+	};
+	auto it = _glyphs.find(key);
+	if (it == _glyphs.end()) {
+		if (_glyphs.size() >= MaxCachedGlyphs)
+			_glyphs.clear();
+		QPixmap glyph(item.rect.size() * key.dpr);
+		glyph.setDevicePixelRatio(key.dpr);
+		glyph.fill(Qt::transparent);
+		QPainter glyph_painter(&glyph);
+		glyph_painter.setPen(painter->pen());
+		auto subopt = item;
+		subopt.rect = QRect(QPoint(), item.rect.size());
+		drawCellContent(subopt, cell_rating, border, &glyph_painter);
+		it = _glyphs.insert(key, glyph);
+	}
+	painter->drawPixmap(item.rect.topLeft(), *it);
+}
+
+void GridViewStyle::drawCellContent(const QStyleOptionViewItem &item, std::optional<double> cell_rating, const QBrush &border, QPainter *painter) const
+{
+	// Check indicator
+	auto text_role = QPalette::Text;
+	if (item.features & QStyleOptionViewItem::HasCheckIndicator) {
+		switch (item.checkState) {
+		case Qt::Checked:
+			painter->fillRect(
+					item.rect.adjusted(ItemMargin, ItemMargin, -ItemMargin, -ItemMargin),
+					item.palette.text());
+			text_role = QPalette::Base;
+			break;
+		case Qt::PartiallyChecked:
+			painter->drawRect(item.rect.adjusted(ItemMargin, ItemMargin, -ItemMargin-1, -ItemMargin-1));
+
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (cell_rating) {
+		auto rating = *cell_rating;
+		QPalette palette = item.palette;
+		if (rating < 0.0)
+			palette.setColor(text_role, Qt::red);
+		PainterSaver ps(*painter);
+		switch (Application::settings().rating_display_mode()) {
+		case RatingDisplay::GrowingBox:
+			painter->setPen(Qt::NoPen);
+			painter->setBrush(palette.color(text_role));
+
+			rating = std::abs(rating);
+			if (rating >= 1.0) {
+				// Draw diamond
+				int size = std::min(item.rect.width(), item.rect.height()) - 2*ItemMargin;
+				painter->setRenderHint(QPainter::Antialiasing);
+				auto center = item.rect.toRectF().center();
+				painter->drawPolygon(QList<QPointF>{
+						center + QPointF{0.0, -size/2.0},
+						center + QPointF{size/3.0, 0.0},
+						center + QPointF{0.0, size/2.0},
+						center + QPointF{-size/3.0, 0.0},
+						});
 			}
-			else { // Text content
-				PainterSaver ps(*painter);
-				painter->setFont(item->font);
-				proxy()->drawItemText(painter, option->rect, Qt::AlignCenter,
-						option->palette, option->state & QStyle::State_Enabled,
-						item->text, text_role);
+			else if (rating >= 0.05) {
+				// Draw square proportional to rating
+				int size = (std::min(item.rect.width(), item.rect.height()) - 3*ItemMargin) * rating + 0.5;
+				painter->drawRect(item.rect.adjusted(
+						(item.rect.width()-size+1)/2,
+						(item.rect.height()-size+1)/2,
+						-(item.rect.width()-size+1)/2,
+						-(item.rect.height()-size+1)/2));
 			}
+			break;
+		case RatingDisplay::Text:
+			painter->setFont(item.font);
+			proxy()->drawItemText(painter, item.rect, Qt::AlignCenter,
+					palette, item.state & QStyle::State_Enabled,
+					item.text, text_role);
+			break;
+		}
+	}
+	else { // Text content
+		PainterSaver ps(*painter);
+		painter->setFont(item.font);
+		proxy()->drawItemText(painter, item.rect, Qt::AlignCenter,
+				item.palette, item.state & QStyle::State_Enabled,
+				item.text, text_role);
+	}
 
-			// Disabled cells
-			if (!option->state.testFlag(QStyle::State_Enabled)) {
-				auto disabled = QBrush(Qt::red, Qt::DiagCrossPattern);
-				painter->fillRect(option->rect, disabled);
-			}
+	// Disabled cells
+	if (!item.state.testFlag(QStyle::State_Enabled)) {
+		auto disabled = QBrush(Qt::red, Qt::DiagCrossPattern);
+		painter->fillRect(item.rect, disabled);
+	}
 
-			// Border highlight
-			auto border = item->index.data(DataRole::BorderRole);
-			if (border.canConvert<QBrush>()) {
-				PainterSaver ps(*painter);
-				QPen pen;
-				pen.setBrush(border.value<QBrush>());
-				pen.setWidth(ItemBorder);
-				painter->setPen(pen);
-				painter->drawRect(option->rect.adjusted(ItemBorder, ItemBorder, -ItemBorder, -ItemBorder));
-			}
-			return;
+	// Border highlight
+	if (border.style() != Qt::NoBrush) {
+		PainterSaver ps(*painter);
+		QPen pen;
+		pen.setBrush(border);
+		pen.setWidth(ItemBorder);
+		painter->setPen(pen);
+		painter->drawRect(item.rect.adjusted(ItemBorder, ItemBorder, -ItemBorder, -ItemBorder));
+	}
+}
+
+namespace {
+
+// Rectangles grouped by brush
+class RectBatches
+{
+public:
+	void add(const QBrush &brush, const QRect &rect)
+	{
+		auto it = std::ranges::find(_batches, brush, &batch_t::first);
+		if (it == _batches.end())
+			_batches.emplace_back(brush, QList<QRect>{rect});
+		else
+			it->second.append(rect);
+	}
+
+	void fill(QPainter *painter) const
+	{
+		PainterSaver ps(*painter);
+		painter->setPen(Qt::NoPen);
+		for (const auto &[brush, rects]: _batches) {
+			painter->setBrush(brush);
+			painter->drawRects(rects);
 		}
-	default:
-		break;
 	}
-	baseStyle()->drawControl(element, option, painter, widget);
+
+	void stroke(QPainter *painter, int width) const
+	{
+		PainterSaver ps(*painter);
+		painter->setBrush(Qt::NoBrush);
+		for (const auto &[brush, rects]: _batches) {
+			QPen pen;
+			pen.setBrush(brush);
+			pen.setWidth(width);
+			painter->setPen(pen);
+			painter->drawRects(rects);
+		}
+	}
+
+private:
+	using batch_t = std::pair<QBrush, QList<QRect>>;
+	std::vector<batch_t> _batches;
+};
+
+}
+
+void GridViewStyle::drawPanels(const QStyleOptionViewItem &row, std::span<const Cell> cells, QPainter *painter, const QWidget *widget) const
+{
+	auto cg = colorGroup(row, widget);
+	auto highlight = row.palette.color(cg, QPalette::Highlight);
+	auto text = row.palette.color(cg, QPalette::WindowText);
+	RectBatches backgrounds, selected, grid;
+	for (const auto &cell: cells) {
+		if (cell.state->background.style() != Qt::NoBrush)
+			backgrounds.add(cell.state->background, cell.rect);
+		if (cell.selected)
+			selected.add(withAlpha(highlight, 100), cell.rect);
+		grid.add(withAlpha(text, 50), cell.rect.adjusted(0, 0, -1, -1));
+	}
+	backgrounds.fill(painter);
+	selected.fill(painter);
+	grid.stroke(painter, 1);
+	for (const auto &cell: cells)
+		if (cell.hovered)
+			drawHover(painter, cell.rect, highlight, text);
+}
+
+void GridViewStyle::drawCells(const QStyleOptionViewItem &row, std::span<const Cell> cells, QPainter *painter, const QWidget *widget) const
+{
+	drawPanels(row, cells, painter, widget);
+
+	auto item = row;
+	for (const auto &cell: cells) {
+		const auto &state = *cell.state;
+		item.rect = cell.rect;
+		item.text = state.text;
+		item.features.setFlag(QStyleOptionViewItem::HasDisplay, !state.text.isEmpty());
+		item.features.setFlag(QStyleOptionViewItem::HasCheckIndicator, state.check.has_value());
+		item.checkState = state.check.value_or(Qt::Unchecked);
+		item.state.setFlag(QStyle::State_Enabled,
+				(row.state & QStyle::State_Enabled) && (state.flags & Qt::ItemIsEnabled));
+		drawCachedContent(item, state.rating, state.border, painter);
+	}
 }
 
 void GridViewStyle::drawPrimitive(PrimitiveElement element, const QStyleOption *option, QPainter *painter, const QWidget *widget) const
@@ -219,36 +382,15 @@ void GridViewStyle::drawPrimitive(PrimitiveElement element, const QStyleOption *
 	switch (element) {
 	case PE_PanelItemViewItem:
 		if (auto item = qstyleoption_cast<const QStyleOptionViewItem *>(option)) {
-			auto cg = (widget ? widget->isEnabled() : item->state & QStyle::State_Enabled)
-				? (item->state & QStyle::State_Active
-					? QPalette::Normal
-					: QPalette::Inactive)
-				: QPalette::Disabled;
-			auto highlight = item->palette.color(cg, QPalette::Highlight);
-			auto text = item->palette.color(cg, QPalette::WindowText);
-			if (item->index.column() == 0) {
-				baseStyle()->drawPrimitive(element, option, painter, widget);
-			}
-			else {
-				if (item->backgroundBrush.style() != Qt::NoBrush) {
-					painter->fillRect(item->rect, item->backgroundBrush);
-				}
-				if (item->state & QStyle::State_Selected) {
-					// Draw selected highlight
-					painter->fillRect(item->rect, withAlpha(highlight, 100));
-				}
-				// Draw grid
-				drawBorder(painter,
-						item->rect.adjusted(0, 0, -1, -1),
-						QColor(withAlpha(text, 50)));
-			}
+			// Only the name column is painted as an item, grid cells
+			// are painted by drawCells
+			baseStyle()->drawPrimitive(element, option, painter, widget);
 			if (item->state & QStyle::State_MouseOver) {
 				// Draw mouse over highlight for all columns
-				PainterSaver ps(*painter);
-				painter->fillRect(item->rect, withAlpha(highlight, 50));
-				painter->setPen(mix(highlight, text));
-				painter->drawLine(item->rect.topLeft(), item->rect.topRight());
-				painter->drawLine(item->rect.bottomLeft(), item->rect.bottomRight());
+				auto cg = colorGroup(*item, widget);
+				drawHover(painter, item->rect,
+						item->palette.color(cg, QPalette::Highlight),
+						item->palette.color(cg, QPalette::WindowText));
 			}
 			return;
 		}
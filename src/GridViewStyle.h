@@ -20,8 +20,16 @@
 #define GRID_VIEW_STYLE_H
 
 #include <QProxyStyle>
+#include <QHash>
+#include <QPixmap>
+#include <QFont>
+
+#include <optional>
+
+#include "AbstractColumn.h"
 
 class QStyleOptionHeader;
+class QStyleOptionViewItem;
 
 class GridViewStyle: public QProxyStyle
 {
@@ -36,8 +44,63 @@ public:
 	QSize sizeFromContents(ContentsType type, const QStyleOption *option, const QSize &size, const QWidget *widget) const override;
 	QRect subElementRect(SubElement element, const QStyleOption *option, const QWidget *widget) const override;
 
+	struct Cell {
+		QRect rect;
+		const AbstractColumn::CellState *state;
+		bool selected;
+		bool hovered;
+	};
+	// Draw grid cells: the panels (background, selection, grid and hover)
+	// of all the cells are filled at once grouped by brush, then the
+	// content of each cell. row provides the palette, font and state.
+	void drawCells(const QStyleOptionViewItem &row, std::span<const Cell> cells, QPainter *painter, const QWidget *widget = nullptr) const;
+
 private:
 	bool isVertical(const QStyleOptionHeader &header) const;
+	void drawPanels(const QStyleOptionViewItem &row, std::span<const Cell> cells, QPainter *painter, const QWidget *widget) const;
+	// Content is blitted from a cached glyph unless it contains text
+	void drawCachedContent(const QStyleOptionViewItem &item, std::optional<double> rating, const QBrush &border, QPainter *painter) const;
+	void drawCellContent(const QStyleOptionViewItem &item, std::optional<double> rating, const QBrush &border, QPainter *painter) const;
+
+	// Pre-rendered cell content (everything but the panel) for cells
+	// without text
+	struct glyph_key_t {
+		QSize size;
+		qreal dpr;
+		int shape; // 0: none, -1: diamond, otherwise square size
+		int check; // Qt::CheckState or -1 without check indicator
+		bool negative;
+		bool enabled;
+		QRgb text, base, pen;
+		QRgb border; // 0 for no border
+		bool operator==(const glyph_key_t &) const = default;
+		friend size_t qHash(const glyph_key_t &key, size_t seed = 0) {
+			return qHashMulti(seed, key.size.width(), key.size.height(), key.dpr,
+					key.shape, key.check, key.negative, key.enabled,
+					key.text, key.base, key.pen, key.border);
+		}
+	};
+	static constexpr qsizetype MaxCachedGlyphs = 1024;
+	mutable QHash<glyph_key_t, QPixmap> _glyphs;
+
+	// Rotated header labels
+	struct header_key_t {
+		int section;
+		QString text;
+		QSize size;
+		qreal dpr;
+		QFont font;
+		QRgb color;
+		int state;
+		bool operator==(const header_key_t &) const = default;
+		friend size_t qHash(const header_key_t &key, size_t seed = 0) {
+			return qHashMulti(seed, key.section, key.text,
+					key.size.width(), key.size.height(), key.dpr,
+					key.font, key.color, key.state);
+		}
+	};
+	static constexpr qsizetype MaxCachedHeaders = 512;
+	mutable QHash<header_key_t, QPixmap> _headers;
 };
 
 #endif
@@ -88,6 +88,8 @@ MainWindow::MainWindow(QWidget *parent):
 	auto unit_details = new UnitDetails::Dock(_df->data(), this);
 	addDockWidget(Qt::LeftDockWidgetArea, unit_details);
 	_ui->view_menu->addAction(unit_details->toggleViewAction());
+	connect(_df.get(), &DwarfFortress::unitInventoryAvailable,
+			unit_details, &UnitDetails::Dock::setInventoryAvailable);
 
 	auto log = new LogDock(this);
 	addDockWidget(Qt::BottomDockWidgetArea, log);
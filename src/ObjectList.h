@@ -33,6 +33,11 @@ public:
 
 signals:
 	void unitDataChanged(int row, const QItemSelection &units);
+	// Emitted before objects are inserted, removed or modified in place,
+	// and by DwarfFortressData before any data read by the objects
+	// changes. Objects read from other threads must not be used after it
+	// returns.
+	void aboutToUpdate();
 };
 
 template <typename T>
@@ -110,6 +115,7 @@ public:
 	void update(std::vector<std::unique_ptr<df_type>> &&new_objects, Factory &&factory)
 	{
 		static const GetKey<T> get_key;
+		aboutToUpdate();
 		auto old_it = _objects.begin();
 		auto new_it = new_objects.begin();
 		while (old_it != _objects.end() || new_it != new_objects.end()) {
@@ -119,12 +125,22 @@ public:
 					new_it, new_objects.end(),
 					std::equal_to{}, get_key, get_key);
 			if (old_match_end != old_it) {
-				int first_row = distance(_objects.begin(), old_it);
-				for (auto &u: std::ranges::subrange(new_it, new_match_end))
-					(*old_it++)->update(std::move(u));
+				// Only signal ranges of objects that actually changed
+				int row = distance(_objects.begin(), old_it);
+				int changed_first = -1;
+				for (auto &u: std::ranges::subrange(new_it, new_match_end)) {
+					bool changed = updateObject(**old_it++, std::move(u));
+					if (changed && changed_first < 0)
+						changed_first = row;
+					else if (!changed && changed_first >= 0) {
+						dataChanged(index(changed_first), index(row-1));
+						changed_first = -1;
+					}
+					++row;
+				}
+				if (changed_first >= 0)
+					dataChanged(index(changed_first), index(row-1));
 				new_it = new_match_end;
-				int last_row = distance(_objects.begin(), old_it)-1;
-				dataChanged(index(first_row), index(last_row));
 			}
 
 			// Remove missing units
@@ -157,6 +173,7 @@ public:
 	void update(std::vector<std::unique_ptr<df_type>> &&new_objects, Factory &&factory)
 	{
 		static const GetName<T> get_name;
+		aboutToUpdate();
 		// longest common subsequence for each prefix pair
 		auto lcs = std::vector<std::size_t>((_objects.size()+1)*(new_objects.size()+1), 0);
 		std::size_t stride = _objects.size()+1;
@@ -203,20 +220,22 @@ public:
 				}
 				// Rename objects
 				for (std::size_t i = 0; i < renamed_count; ++i) {
-					_objects[old_i+i]->update(std::move(new_objects[new_i+i]));
-					dataChanged(index(old_i+i), index(old_i+i));
+					if (updateObject(*_objects[old_i+i], std::move(new_objects[new_i+i])))
+						dataChanged(index(old_i+i), index(old_i+i));
 				}
 			}
 			else {
 				// Update an object as part of the longest common subsequence
-				_objects[--old_i]->update(std::move(new_objects[--new_i]));
-				dataChanged(index(old_i), index(old_i));
+				--old_i, --new_i;
+				if (updateObject(*_objects[old_i], std::move(new_objects[new_i])))
+					dataChanged(index(old_i), index(old_i));
 			}
 		}
 	}
 
 	void clear()
 	{
+		aboutToUpdate();
 		beginRemoveRows({}, 0, _objects.size()-1);
 		_objects.clear();
 		endRemoveRows();
@@ -301,6 +320,18 @@ protected:
 private:
 	using object_iterator = decltype(_objects)::iterator;
 
+	// Objects whose update returns changes are only signaled when
+	// something changed, others are always considered changed.
+	static bool updateObject(T &object, std::unique_ptr<df_type> &&df_object)
+	{
+		if constexpr (std::is_void_v<decltype(object.update(std::move(df_object)))>) {
+			object.update(std::move(df_object));
+			return true;
+		}
+		else
+			return static_cast<bool>(object.update(std::move(df_object)));
+	}
+
 	template <std::ranges::random_access_range Rng, ObjectFactory<T> Factory>
 	auto insertNewObjects(object_iterator it, Rng &&range, Factory &&factory)
 	{
@@ -56,6 +56,8 @@ void PreferencesDialog::loadSettings()
 	_ui->autorefresh_enable->setChecked(settings.autorefresh_enabled());
 	_ui->autorefresh_interval->setValue(settings.autorefresh_interval());
 	_ui->use_native_process->setChecked(settings.use_native_process());
+	_ui->use_unit_records->setChecked(settings.use_unit_records());
+	_ui->dfhack_read_connections->setValue(settings.dfhack_read_connections());
 	_ui->bypass_work_detail_protection->setChecked(settings.bypass_work_detail_protection());
 	_ui->gridview_perview_groups->setChecked(settings.per_view_group_by());
 	_ui->gridview_perview_filters->setChecked(settings.per_view_filters());
@@ -72,6 +74,8 @@ void PreferencesDialog::loadDefaultSettings()
 	_ui->autorefresh_enable->setChecked(settings.autorefresh_enabled.defaultValue());
 	_ui->autorefresh_interval->setValue(settings.autorefresh_interval.defaultValue());
 	_ui->use_native_process->setChecked(settings.use_native_process.defaultValue());
+	_ui->use_unit_records->setChecked(settings.use_unit_records.defaultValue());
+	_ui->dfhack_read_connections->setValue(settings.dfhack_read_connections.defaultValue());
 	_ui->bypass_work_detail_protection->setChecked(settings.bypass_work_detail_protection.defaultValue());
 	_ui->gridview_perview_groups->setChecked(settings.per_view_group_by.defaultValue());
 	_ui->gridview_perview_filters->setChecked(settings.per_view_filters.defaultValue());
@@ -88,6 +92,8 @@ void PreferencesDialog::saveSettings() const
 	settings.autorefresh_enabled = _ui->autorefresh_enable->isChecked();
 	settings.autorefresh_interval = _ui->autorefresh_interval->value();
 	settings.use_native_process = _ui->use_native_process->isChecked();
+	settings.use_unit_records = _ui->use_unit_records->isChecked();
+	settings.dfhack_read_connections = _ui->dfhack_read_connections->value();
 	settings.bypass_work_detail_protection = _ui->bypass_work_detail_protection->isChecked();
 	settings.per_view_group_by = _ui->gridview_perview_groups->isChecked();
 	settings.per_view_filters = _ui->gridview_perview_filters->isChecked();
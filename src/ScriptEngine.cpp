@@ -0,0 +1,343 @@
+/*
+ * Copyright 2024 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "ScriptEngine.h"
+
+#include "DwarfFortressData.h"
+#include "Unit.h"
+#include "UnitScriptWrapper.h"
+#include "LogCategory.h"
+
+#include <QMetaEnum>
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Compiled scripts are dropped when there are more, temporary script
+// filters create a new source for each edit.
+static constexpr qsizetype MaxCompiledScripts = 64;
+
+ScriptEngine::ScriptEngine():
+	_test_dummy(_js.newQObject(new UnitScriptWrapper)),
+	_unit_array(_js.newArray()),
+	_unit_table(new UnitTableScriptWrapper)
+{
+	_js.installExtensions(QJSEngine::ConsoleExtension);
+	// Results are returned as bytes in an ArrayBuffer (converted to a
+	// QByteArray), the number of failed calls and the last error are
+	// stored in the errors property.
+	_batch_filter = _js.evaluate(R"js((f, units, count) => {
+		const results = new Uint8Array(count);
+		const errors = { count: 0, last: undefined };
+		for (let i = 0; i < count; ++i) {
+			try {
+				results[i] = f(units[i]) ? 1 : 0;
+			}
+			catch (e) {
+				++errors.count;
+				errors.last = e;
+			}
+		}
+		return { results: results.buffer, errors: errors };
+	})js");
+	Q_ASSERT(_batch_filter.isCallable());
+	_batch_map = _js.evaluate(R"js((f, units, count) => {
+		const results = new Array(count);
+		const errors = { count: 0, last: undefined };
+		for (let i = 0; i < count; ++i) {
+			try {
+				results[i] = f(units[i]);
+			}
+			catch (e) {
+				++errors.count;
+				errors.last = e;
+			}
+		}
+		return { results: results, errors: errors };
+	})js");
+	Q_ASSERT(_batch_map.isCallable());
+	for (const auto &[name, values]: enums()) {
+		auto object = _js.newObject();
+		for (const auto &[value_name, value]: values)
+			object.setProperty(value_name, value);
+		_js.globalObject().setProperty(name, object);
+	}
+	_js.globalObject().setProperty("units", _js.newQObject(_unit_table));
+}
+
+ScriptEngine::~ScriptEngine()
+{
+}
+
+QJSValue ScriptEngine::compile(const QString &source)
+{
+	auto it = _compiled.find(source);
+	if (it != _compiled.end())
+		return *it;
+	if (_compiled.size() >= MaxCompiledScripts)
+		_compiled.clear();
+	auto script = _js.evaluate(source);
+	if (!script.isError())
+		_compiled.insert(source, script);
+	return script;
+}
+
+bool ScriptEngine::filterUnit(const QJSValue &script, const Unit &unit)
+{
+	reserveUnitWrappers(1);
+	auto &[wrapper, value] = _unit_wrappers.front();
+	wrapper->setUnit(&unit);
+	_unit_table->setTable(unit.data().unit_table.get());
+	auto result = script.call({value});
+	wrapper->setUnit(nullptr);
+	_unit_table->setTable(nullptr);
+	if (result.isError()) {
+		qCCritical(ScriptLog) << "Filter script failed:" << result.property("message").toString();
+		return false;
+	}
+	return result.toBool();
+}
+
+void ScriptEngine::filterUnits(const QJSValue &script, std::span<const Unit *> units)
+{
+	std::vector<std::size_t> indices;
+	for (std::size_t i = 0; i < units.size(); ++i)
+		if (units[i])
+			indices.push_back(i);
+	if (indices.empty())
+		return;
+	reserveUnitWrappers(indices.size());
+	for (std::size_t i = 0; i < indices.size(); ++i)
+		_unit_wrappers[i].first->setUnit(units[indices[i]]);
+	_unit_table->setTable(units[indices.front()]->data().unit_table.get());
+	auto result = _batch_filter.call({script, _unit_array, int(indices.size())});
+	releaseUnitWrappers(indices.size());
+	_unit_table->setTable(nullptr);
+	if (result.isError()) {
+		qCCritical(ScriptLog) << "Filter script failed:" << result.property("message").toString();
+		for (auto i: indices)
+			units[i] = nullptr;
+		return;
+	}
+	auto errors = result.property("errors");
+	if (int count = errors.property("count").toInt(); count > 0)
+		qCCritical(ScriptLog) << "Filter script failed for" << count << "units:"
+			<< errors.property("last").property("message").toString();
+	auto results = result.property("results").toVariant().toByteArray();
+	Q_ASSERT(std::size_t(results.size()) == indices.size());
+	for (std::size_t i = 0; i < indices.size(); ++i)
+		if (!results[i])
+			units[indices[i]] = nullptr;
+}
+
+std::vector<QJSValue> ScriptEngine::mapUnits(const QJSValue &function, std::span<const Unit *const> units)
+{
+	std::vector<QJSValue> values(units.size());
+	if (units.empty())
+		return values;
+	reserveUnitWrappers(units.size());
+	for (std::size_t i = 0; i < units.size(); ++i)
+		_unit_wrappers[i].first->setUnit(units[i]);
+	_unit_table->setTable(units.front()->data().unit_table.get());
+	auto result = _batch_map.call({function, _unit_array, int(units.size())});
+	releaseUnitWrappers(units.size());
+	_unit_table->setTable(nullptr);
+	if (result.isError()) {
+		qCCritical(ScriptLog) << "Script failed:" << result.property("message").toString();
+		return values;
+	}
+	auto errors = result.property("errors");
+	if (int count = errors.property("count").toInt(); count > 0)
+		qCCritical(ScriptLog) << "Script failed for" << count << "units:"
+			<< errors.property("last").property("message").toString();
+	auto results = result.property("results");
+	for (std::size_t i = 0; i < units.size(); ++i)
+		values[i] = results.property(quint32(i));
+	return values;
+}
+
+void ScriptEngine::reserveUnitWrappers(std::size_t count)
+{
+	while (_unit_wrappers.size() < count) {
+		auto wrapper = new UnitScriptWrapper;
+		auto value = _js.newQObject(wrapper);
+		_unit_array.setProperty(quint32(_unit_wrappers.size()), value);
+		_unit_wrappers.emplace_back(wrapper, std::move(value));
+	}
+}
+
+void ScriptEngine::releaseUnitWrappers(std::size_t count)
+{
+	// Do not keep units alive from the pool
+	for (std::size_t i = 0; i < count; ++i)
+		_unit_wrappers[i].first->setUnit(nullptr);
+}
+
+template <std::ranges::input_range R>
+static UnitFilterCompiler::enum_values_t makeEnumValues(R &&values)
+{
+	UnitFilterCompiler::enum_values_t result;
+	for (auto value: values)
+		result.emplace(QString::fromLocal8Bit(to_string(value)), static_cast<int>(value));
+	return result;
+}
+
+// Values are bit masks for the units.flags array
+static UnitFilterCompiler::enum_values_t makeFlagValues()
+{
+	UnitFilterCompiler::enum_values_t result;
+	auto meta = QMetaEnum::fromType<Unit::Flag>();
+	for (int i = 0; i < meta.keyCount(); ++i)
+		result.emplace(QString::fromLatin1(meta.key(i)), 1 << meta.value(i));
+	return result;
+}
+
+const std::vector<std::pair<QString, UnitFilterCompiler::enum_values_t>> &ScriptEngine::enums()
+{
+	static const std::vector<std::pair<QString, UnitFilterCompiler::enum_values_t>> enums = {
+		{"profession", makeEnumValues(df::profession::AllValues)},
+		{"job_skill", makeEnumValues(df::job_skill::AllValues)},
+		{"physical_attribute_type", makeEnumValues(df::physical_attribute_type::AllValues)},
+		{"mental_attribute_type", makeEnumValues(df::mental_attribute_type::AllValues)},
+		{"unit_flag", makeFlagValues()},
+	};
+	return enums;
+}
+
+struct ScriptEngine::TimeBudget::entry_t
+{
+	QJSEngine *js;
+	std::chrono::steady_clock::time_point deadline;
+	bool fired = false; // protected by the watchdog mutex
+};
+
+namespace {
+
+// Single thread interrupting engines whose time budget expired
+class Watchdog
+{
+public:
+	using entry_t = ScriptEngine::TimeBudget::entry_t;
+
+	static Watchdog &instance()
+	{
+		static Watchdog watchdog;
+		return watchdog;
+	}
+
+	void arm(std::shared_ptr<entry_t> entry)
+	{
+		std::lock_guard lock(_mutex);
+		_entries.push_back(std::move(entry));
+		_changed.notify_one();
+	}
+
+	// Returns true if the engine was interrupted
+	bool disarm(const std::shared_ptr<entry_t> &entry)
+	{
+		std::lock_guard lock(_mutex);
+		std::erase(_entries, entry);
+		return entry->fired;
+	}
+
+	bool fired(const entry_t &entry)
+	{
+		std::lock_guard lock(_mutex);
+		return entry.fired;
+	}
+
+private:
+	Watchdog():
+		_stop(false),
+		_thread([this]() { run(); })
+	{
+	}
+
+	~Watchdog()
+	{
+		{
+			std::lock_guard lock(_mutex);
+			_stop = true;
+		}
+		_changed.notify_one();
+		_thread.join();
+	}
+
+	void run()
+	{
+		using clock = std::chrono::steady_clock;
+		std::unique_lock lock(_mutex);
+		while (!_stop) {
+			auto now = clock::now();
+			auto next = clock::time_point::max();
+			for (const auto &entry: _entries) {
+				if (entry->fired)
+					continue;
+				if (entry->deadline <= now) {
+					entry->js->setInterrupted(true);
+					entry->fired = true;
+				}
+				else
+					next = std::min(next, entry->deadline);
+			}
+			if (next == clock::time_point::max())
+				_changed.wait(lock);
+			else
+				_changed.wait_until(lock, next);
+		}
+	}
+
+	std::mutex _mutex;
+	std::condition_variable _changed;
+	std::vector<std::shared_ptr<entry_t>> _entries;
+	bool _stop;
+	std::thread _thread;
+};
+
+} // namespace
+
+ScriptEngine::TimeBudget::TimeBudget(ScriptEngine &engine, std::chrono::milliseconds budget):
+	_entry(std::make_shared<entry_t>(entry_t{&engine.js(), std::chrono::steady_clock::now() + budget}))
+{
+	Watchdog::instance().arm(_entry);
+}
+
+ScriptEngine::TimeBudget::~TimeBudget()
+{
+	// The engine may be interrupted after the last call returned, it must
+	// be usable by the next calls.
+	if (Watchdog::instance().disarm(_entry))
+		_entry->js->setInterrupted(false);
+}
+
+bool ScriptEngine::TimeBudget::exceeded() const
+{
+	return Watchdog::instance().fired(*_entry);
+}
+
+ScriptEngine &ScriptEngine::threadEngine()
+{
+	thread_local std::unique_ptr<ScriptEngine> engine;
+	if (!engine)
+		engine = std::make_unique<ScriptEngine>();
+	return *engine;
+}
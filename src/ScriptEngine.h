@@ -0,0 +1,104 @@
+/*
+ * Copyright 2024 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef SCRIPT_ENGINE_H
+#define SCRIPT_ENGINE_H
+
+#include <QJSEngine>
+#include <QHash>
+
+#include <chrono>
+#include <memory>
+#include <span>
+
+#include "UnitFilterCompiler.h"
+
+class Unit;
+class UnitScriptWrapper;
+class UnitTableScriptWrapper;
+
+// A JavaScript engine with the unit script globals. ScriptManager owns the
+// GUI thread engine, worker threads use their own from threadEngine().
+class ScriptEngine
+{
+public:
+	ScriptEngine();
+	~ScriptEngine();
+
+	QJSEngine &js() { return _js; }
+	const QJSValue &testDummy() const { return _test_dummy; }
+
+	// Evaluate source in this engine, results are cached by source text
+	// so that each thread compiles a script only once.
+	QJSValue compile(const QString &source);
+
+	// Call a filter script with a pooled unit wrapper, errors are logged and
+	// count as rejections.
+	bool filterUnit(const QJSValue &script, const Unit &unit);
+	// Call a filter script on all non-null units in a single engine call,
+	// rejected units are replaced with nullptr.
+	void filterUnits(const QJSValue &script, std::span<const Unit *> units);
+	// Call a function on all units in a single engine call, errors are
+	// logged and give undefined results.
+	std::vector<QJSValue> mapUnits(const QJSValue &function, std::span<const Unit *const> units);
+
+	// Enum objects added as globals in every engine
+	static const std::vector<std::pair<QString, UnitFilterCompiler::enum_values_t>> &enums();
+
+	// Engine for the calling thread, created on first use and destroyed
+	// with the thread.
+	static ScriptEngine &threadEngine();
+
+	// Interrupts the engine from a watchdog thread if calls made during
+	// the lifetime of this object take longer than budget. Interrupted
+	// calls return an error.
+	class TimeBudget
+	{
+	public:
+		TimeBudget(ScriptEngine &engine, std::chrono::milliseconds budget);
+		~TimeBudget();
+
+		// The engine was interrupted, results from the calls are not
+		// reliable.
+		bool exceeded() const;
+
+		struct entry_t;
+	private:
+		std::shared_ptr<entry_t> _entry;
+	};
+
+private:
+	void reserveUnitWrappers(std::size_t count);
+	void releaseUnitWrappers(std::size_t count);
+
+	QJSEngine _js;
+	QJSValue _test_dummy;
+	// Wrappers are retargeted for each call instead of creating a new
+	// wrapper for each unit, _unit_array holds the same wrappers for the
+	// batch function.
+	std::vector<std::pair<UnitScriptWrapper *, QJSValue>> _unit_wrappers;
+	QJSValue _unit_array;
+	QJSValue _batch_filter;
+	QJSValue _batch_map;
+	// The units global, retargeted to the table of the filtered units
+	UnitTableScriptWrapper *_unit_table;
+	QHash<QString, QJSValue> _compiled;
+};
+
+#endif
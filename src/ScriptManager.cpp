@@ -25,6 +25,21 @@
 
 #include <QMetaProperty>
 #include <QMetaMethod>
+#include <QMutex>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <memory>
+#include <optional>
+
+// Chunks are large enough for the batch call to amortize the thread
+// switch, and small enough to use every pool thread.
+static constexpr std::size_t FilterChunkMinSize = 64;
+
+static QString scriptSource(const QString &expression)
+{
+	return QString("(u) => Boolean(%1)").arg(expression);
+}
 
 static void printError(const QJSValue &error)
 {
@@ -35,68 +50,87 @@ static void printError(const QJSValue &error)
 		.arg(error.property("message").toString());
 }
 
-ScriptManager::ScriptManager():
-	_test_dummy(_js.newQObject(new UnitScriptWrapper))
-{
-	_js.installExtensions(QJSEngine::ConsoleExtension);
-	{ // Add unit properties to properties model
-		auto item = new QStandardItem("u");
-		const auto &meta_unit = UnitScriptWrapper::staticMetaObject;
-		for (int i = meta_unit.propertyOffset(); i < meta_unit.propertyCount(); ++i) {
-			auto prop = meta_unit.property(i);
-			auto prop_item = new QStandardItem();
-			prop_item->setData(prop.name(), Qt::EditRole);
-			int doc = meta_unit.indexOfClassInfo((QByteArray("doc:") + prop.name()).data());
-			if (doc == -1) {
-				prop_item->setData(QString("property %1: %2")
-						.arg(prop.name())
-						.arg(prop.typeName()),
-						Qt::StatusTipRole);
-			}
-			else {
-				prop_item->setData(QString("property %1: %2 – %3")
-						.arg(prop.name())
-						.arg(prop.typeName())
-						.arg(meta_unit.classInfo(doc).value()),
-						Qt::StatusTipRole);
-			}
-			item->appendRow(prop_item);
+static std::optional<QString> classInfo(const QMetaObject &meta, const char *prefix, const QByteArray &name)
+{
+	int index = meta.indexOfClassInfo((QByteArray(prefix) + name).data());
+	if (index == -1)
+		return std::nullopt;
+	return QString::fromUtf8(meta.classInfo(index).value());
+}
+
+// Documentation of properties and methods from a wrapper, with optional
+// "doc:<name>" class info, and "type:<name>" replacing the C++ type.
+static QStandardItem *makeObjectItem(const QString &name, const QMetaObject &meta)
+{
+	auto item = new QStandardItem(name);
+	for (int i = meta.propertyOffset(); i < meta.propertyCount(); ++i) {
+		auto prop = meta.property(i);
+		auto prop_item = new QStandardItem();
+		auto type = classInfo(meta, "type:", prop.name()).value_or(prop.typeName());
+		prop_item->setData(prop.name(), Qt::EditRole);
+		int doc = meta.indexOfClassInfo((QByteArray("doc:") + prop.name()).data());
+		if (doc == -1) {
+			prop_item->setData(QString("property %1: %2")
+					.arg(prop.name())
+					.arg(type),
+					Qt::StatusTipRole);
 		}
-		for (int i = meta_unit.methodOffset(); i < meta_unit.methodCount(); ++i) {
-			auto method = meta_unit.method(i);
-			if (method.access() != QMetaMethod::Public)
-				continue;
-			if (method.methodType() == QMetaMethod::Constructor
-					|| method.methodType() == QMetaMethod::Signal)
-				continue;
-			auto method_item = new QStandardItem();
-			method_item->setData(method.name(), Qt::EditRole);
-			QStringList params_doc;
-			for (int j = 0; j < method.parameterCount(); ++j)
-				params_doc.push_back(QString("%1: %2")
-						.arg(method.parameterNames().at(j))
-						.arg(method.parameterTypeName(j)));
-			int doc = meta_unit.indexOfClassInfo((QByteArray("doc:") + method.name()).data());
-			if (doc == -1) {
-				method_item->setData(QString("function %1(%2): %3")
-						.arg(method.name())
-						.arg(params_doc.join(", "))
-						.arg(method.returnMetaType().name()),
-						Qt::StatusTipRole);
-			}
-			else {
-				method_item->setData(QString("function %1(%2): %3 – %4")
-						.arg(method.name())
-						.arg(params_doc.join(", "))
-						.arg(method.returnMetaType().name())
-						.arg(meta_unit.classInfo(doc).value()),
-						Qt::StatusTipRole);
-			}
-			item->appendRow(method_item);
+		else {
+			prop_item->setData(QString("property %1: %2 – %3")
+					.arg(prop.name())
+					.arg(type)
+					.arg(meta.classInfo(doc).value()),
+					Qt::StatusTipRole);
+		}
+		item->appendRow(prop_item);
+	}
+	for (int i = meta.methodOffset(); i < meta.methodCount(); ++i) {
+		auto method = meta.method(i);
+		if (method.access() != QMetaMethod::Public)
+			continue;
+		if (method.methodType() == QMetaMethod::Constructor
+				|| method.methodType() == QMetaMethod::Signal)
+			continue;
+		auto method_item = new QStandardItem();
+		auto type = classInfo(meta, "type:", method.name()).value_or(method.returnMetaType().name());
+		method_item->setData(method.name(), Qt::EditRole);
+		QStringList params_doc;
+		for (int j = 0; j < method.parameterCount(); ++j)
+			params_doc.push_back(QString("%1: %2")
+					.arg(method.parameterNames().at(j))
+					.arg(method.parameterTypeName(j)));
+		int doc = meta.indexOfClassInfo((QByteArray("doc:") + method.name()).data());
+		if (doc == -1) {
+			method_item->setData(QString("function %1(%2): %3")
+					.arg(method.name())
+					.arg(params_doc.join(", "))
+					.arg(type),
+					Qt::StatusTipRole);
 		}
+		else {
+			method_item->setData(QString("function %1(%2): %3 – %4")
+					.arg(method.name())
+					.arg(params_doc.join(", "))
+					.arg(type)
+					.arg(meta.classInfo(doc).value()),
+					Qt::StatusTipRole);
+		}
+		item->appendRow(method_item);
+	}
+	return item;
+}
+
+ScriptManager::ScriptManager()
+{
+	_properties_model.appendRow(makeObjectItem("u", UnitScriptWrapper::staticMetaObject));
+	_properties_model.appendRow(makeObjectItem("units", UnitTableScriptWrapper::staticMetaObject));
+	for (const auto &[name, values]: ScriptEngine::enums()) {
+		auto item = new QStandardItem(name);
+		for (const auto &[value_name, value]: values)
+			item->appendRow(new QStandardItem(value_name));
 		_properties_model.appendRow(item);
+		_compiler.addEnum(name, values);
 	}
-	addEnumValues("profession", df::profession::AllValues);
 	QStringList name_filter = {"*.js"};
 	for (QDir data_dir: StandardPaths::data_locations()) {
 		QDir dir = data_dir.filePath("unit_filters");
@@ -107,7 +141,8 @@ ScriptManager::ScriptManager():
 				continue;
 			}
 			QTextStream stream(&file);
-			auto result = _js.evaluate(stream.readAll(), fi.filePath());
+			auto text = stream.readAll();
+			auto result = withTimeBudget([&]() { return _engine.js().evaluate(text, fi.filePath()); });
 			if (result.isError()) {
 				printError(result);
 				continue;
@@ -116,14 +151,18 @@ ScriptManager::ScriptManager():
 				qCCritical(ScriptLog) << "Script" << fi.filePath() << "is not callable";
 				continue;
 			}
-			auto test_result = result.call({_test_dummy});
+			auto test_result = withTimeBudget([&]() { return result.call({_engine.testDummy()}); });
 			if (test_result.isError()) {
 				printError(test_result);
 				continue;
 			}
+			auto filter = _compiler.compileFunction(text);
 			qCInfo(ScriptLog) << "Added script" << fi.baseName()
-				<< "from" << fi.absoluteFilePath();
-			_scripts.emplace_back(fi.baseName(), std::move(result));
+				<< "from" << fi.absoluteFilePath()
+				<< (filter ? "(compiled)" : "");
+			if (!filter)
+				filter = ScriptedUnitFilter{std::move(result), std::move(text)};
+			_scripts.emplace_back(fi.baseName(), std::move(filter));
 		}
 	}
 	_properties_model.setSortRole(Qt::EditRole);
@@ -136,32 +175,159 @@ ScriptManager::~ScriptManager()
 
 QJSValue ScriptManager::makeUnit(const Unit &unit)
 {
-	return _js.newQObject(new UnitScriptWrapper(unit));
+	return _engine.js().newQObject(new UnitScriptWrapper(unit));
+}
+
+UnitFilter ScriptManager::makeFilter(const QString &expression, QString *error)
+{
+	if (auto filter = _compiler.compileExpression(expression))
+		return filter;
+	auto script = makeScript(expression);
+	if (script.isError()) {
+		if (error)
+			*error = script.property("message").toString();
+		return {};
+	}
+	return ScriptedUnitFilter{std::move(script), scriptSource(expression)};
+}
+
+QString ScriptManager::timeBudgetMessage()
+{
+	return QString("script exceeded its time budget of %1 ms").arg(ScriptTimeBudget.count());
+}
+
+template <typename F>
+QJSValue ScriptManager::withTimeBudget(F &&f)
+{
+	QJSValue result;
+	bool exceeded;
+	{
+		ScriptEngine::TimeBudget budget(_engine, ScriptTimeBudget);
+		result = f();
+		exceeded = budget.exceeded();
+	}
+	// The engine is no longer interrupted when the budget is destroyed
+	if (exceeded)
+		return _engine.js().newErrorObject(QJSValue::RangeError, timeBudgetMessage());
+	return result;
+}
+
+std::optional<bool> ScriptManager::filterUnit(const QJSValue &script, const Unit &unit)
+{
+	ScriptEngine::TimeBudget budget(_engine, ScriptTimeBudget);
+	auto result = _engine.filterUnit(script, unit);
+	if (budget.exceeded())
+		return std::nullopt;
+	return result;
+}
+
+bool ScriptManager::runChunks(std::size_t size, const std::function<void(ScriptEngine &, std::size_t, std::size_t)> &task)
+{
+	if (size == 0)
+		return true;
+	// The state is shared with the tasks as they may still hold the mutex
+	// when this function returns.
+	struct state_t
+	{
+		QMutex mutex;
+		QWaitCondition finished;
+		std::size_t remaining;
+		bool exceeded = false;
+	};
+	auto state = std::make_shared<state_t>();
+	auto pool = QThreadPool::globalInstance();
+	std::size_t chunk_size = std::max<std::size_t>(FilterChunkMinSize,
+			(size + pool->maxThreadCount() - 1) / pool->maxThreadCount());
+	state->remaining = (size + chunk_size - 1) / chunk_size;
+	for (std::size_t first = 0; first < size; first += chunk_size) {
+		auto count = std::min(chunk_size, size - first);
+		pool->start([state, &task, first, count]() {
+			bool exceeded;
+			{
+				QMutexLocker lock(&state->mutex);
+				exceeded = state->exceeded;
+			}
+			if (!exceeded) {
+				// Time spent waiting in the pool queue does not count
+				auto &engine = ScriptEngine::threadEngine();
+				ScriptEngine::TimeBudget budget(engine, ScriptTimeBudget);
+				task(engine, first, count);
+				exceeded = budget.exceeded();
+			}
+			QMutexLocker lock(&state->mutex);
+			state->exceeded = state->exceeded || exceeded;
+			--state->remaining;
+			state->finished.wakeAll();
+		});
+	}
+	QMutexLocker lock(&state->mutex);
+	while (state->remaining > 0)
+		state->finished.wait(&state->mutex);
+	if (state->exceeded)
+		qCWarning(ScriptLog) << "Script exceeded its time budget of"
+			<< ScriptTimeBudget.count() << "ms";
+	return !state->exceeded;
+}
+
+bool ScriptManager::filterUnits(const QString &source, std::span<const Unit *> units)
+{
+	bool completed = runChunks(units.size(), [&](ScriptEngine &engine, std::size_t first, std::size_t count) {
+		auto chunk = units.subspan(first, count);
+		auto script = engine.compile(source);
+		if (script.isCallable())
+			engine.filterUnits(script, chunk);
+		else {
+			qCCritical(ScriptLog) << "Filter script failed:" << script.property("message").toString();
+			std::ranges::fill(chunk, nullptr);
+		}
+	});
+	if (!completed)
+		std::ranges::fill(units, nullptr);
+	return completed;
+}
+
+std::optional<std::vector<QVariant>> ScriptManager::mapUnits(const QString &source, std::span<const Unit *const> units)
+{
+	std::vector<QVariant> results(units.size());
+	bool completed = runChunks(units.size(), [&](ScriptEngine &engine, std::size_t first, std::size_t count) {
+		auto function = engine.compile(source);
+		if (!function.isCallable()) {
+			qCCritical(ScriptLog) << "Script failed:" << function.property("message").toString();
+			return;
+		}
+		auto values = engine.mapUnits(function, units.subspan(first, count));
+		for (std::size_t i = 0; i < count; ++i)
+			results[first+i] = values[i].toVariant();
+	});
+	if (!completed)
+		return std::nullopt;
+	return results;
 }
 
 QJSValue ScriptManager::makeScript(const QString &expression)
 {
-	auto script = _js.evaluate(QString("(u) => Boolean(%1)").arg(expression));
+	auto script = _engine.js().evaluate(scriptSource(expression));
 	if (script.isError())
 		return script;
-	auto test_result = script.call({_test_dummy});
+	auto test_result = withTimeBudget([&]() { return script.call({_engine.testDummy()}); });
 	if (test_result.isError())
 		return test_result;
 	return script;
 }
 
-template <std::ranges::input_range R>
-void ScriptManager::addEnumValues(const QString &name, R &&values)
+QJSValue ScriptManager::makeFunction(const QString &source)
 {
-	auto object = _js.newObject();
-	auto item = new QStandardItem(name);
-	for (auto value: values) {
-		auto value_name = QString::fromLocal8Bit(to_string(value));
-		object.setProperty(value_name, value);
-		item->appendRow(new QStandardItem(value_name));
-	}
-	_js.globalObject().setProperty(name, object);
-	_properties_model.appendRow(item);
+	// The source is not wrapped in a function, evaluating it may run
+	// arbitrary code.
+	auto function = withTimeBudget([&]() { return _engine.js().evaluate(source); });
+	if (function.isError())
+		return function;
+	if (!function.isCallable())
+		return _engine.js().newErrorObject(QJSValue::TypeError, "script is not a function");
+	auto test_result = withTimeBudget([&]() { return function.call({_engine.testDummy()}); });
+	if (test_result.isError())
+		return test_result;
+	return function;
 }
 
 ScriptPropertiesCompleter::ScriptPropertiesCompleter(QObject *parent):
@@ -23,6 +23,14 @@
 #include <QStandardItemModel>
 #include <QCompleter>
 
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <span>
+
+#include "ScriptEngine.h"
+#include "UnitFilterCompiler.h"
+
 class Unit;
 
 class ScriptManager
@@ -31,21 +39,54 @@ public:
 	ScriptManager();
 	~ScriptManager();
 
-	const std::vector<std::pair<QString, QJSValue>> &filters() const { return _scripts; }
+	const std::vector<std::pair<QString, UnitFilter>> &filters() const { return _scripts; }
 
 	QJSValue makeUnit(const Unit &unit);
 	QJSValue makeScript(const QString &expression);
+	// Evaluate a function taking a unit (e.g. "(u) => u.name"), returns an
+	// error value if the source is not a valid function.
+	QJSValue makeFunction(const QString &source);
+	// Simple expressions are compiled to native filters (see
+	// UnitFilterCompiler), others use makeScript. Returns an empty filter
+	// and sets error if the script is invalid.
+	UnitFilter makeFilter(const QString &expression, QString *error = nullptr);
+
+	// Call a filter script from the GUI thread engine, returns
+	// std::nullopt if the script exceeded ScriptTimeBudget.
+	std::optional<bool> filterUnit(const QJSValue &script, const Unit &unit);
+	// Split units in chunks filtered in parallel by per-thread engines
+	// compiling source, rejected units are replaced with nullptr. Units
+	// must not change until it returns. Each chunk has its own
+	// ScriptTimeBudget starting when it runs, returns false (and rejects
+	// the units) if one exceeded it.
+	bool filterUnits(const QString &source, std::span<const Unit *> units);
+	// Call a function (validated with makeFunction) on all units, in
+	// parallel chunks like filterUnits. Results are converted with
+	// QJSValue::toVariant, errors give null variants. Returns
+	// std::nullopt if a chunk exceeded ScriptTimeBudget.
+	std::optional<std::vector<QVariant>> mapUnits(const QString &source, std::span<const Unit *const> units);
+
+	// Maximum duration of a single script call, in any engine
+	static constexpr std::chrono::milliseconds ScriptTimeBudget{2000};
+	static QString timeBudgetMessage();
 
 	QAbstractItemModel *propertiesModel() { return &_properties_model; }
 
 private:
-	template <std::ranges::input_range R>
-	void addEnumValues(const QString &name, R &&values);
+	// Run f using the GUI thread engine under ScriptTimeBudget, returns
+	// an error value instead of its result if it was interrupted.
+	template <typename F>
+	QJSValue withTimeBudget(F &&f);
+	// Run task(engine, first, count) on chunks of [0, size) in parallel
+	// with per-thread engines, each chunk under its own ScriptTimeBudget
+	// starting when it runs. Returns false if one exceeded it, the
+	// remaining chunks are then skipped.
+	bool runChunks(std::size_t size, const std::function<void(ScriptEngine &, std::size_t, std::size_t)> &task);
 
-	QJSEngine _js;
-	QJSValue _test_dummy;
-	std::vector<std::pair<QString, QJSValue>> _scripts;
+	ScriptEngine _engine;
+	std::vector<std::pair<QString, UnitFilter>> _scripts;
 	QStandardItemModel _properties_model;
+	UnitFilterCompiler _compiler;
 };
 
 class ScriptPropertiesCompleter: public QCompleter
@@ -105,6 +105,10 @@ struct Settings
 	SettingProperty<double> autorefresh_interval = {"autorefresh/interval", 2.0};
 
 	SettingProperty<bool> use_native_process = {"process/use_native", true};
+	SettingProperty<bool> use_unit_records = {"process/use_unit_records", false};
+	// More than one only helps if llmemreader does not suspend the game
+	// for reads (SF_DONT_SUSPEND), DFHack serializes suspending calls.
+	SettingProperty<int> dfhack_read_connections = {"process/dfhack_read_connections", 1, 1, 8};
 
 	SettingProperty<bool> per_view_group_by = {"gridview/per_view_group_by", false};
 	SettingProperty<bool> per_view_filters = {"gridview/per_view_filter", false};
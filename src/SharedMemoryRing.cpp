@@ -0,0 +1,64 @@
+/*
+ * Copyright 2024 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "SharedMemoryRing.h"
+
+#include <algorithm>
+
+std::optional<std::size_t> SharedMemoryRing::allocate(std::size_t size)
+{
+	if (size == 0 || size > _capacity)
+		return std::nullopt;
+	std::lock_guard lock(_mutex);
+	std::size_t offset;
+	if (_regions.empty())
+		offset = 0;
+	else {
+		const auto &front = _regions.front();
+		const auto &back = _regions.back();
+		auto back_end = back.offset + back.size;
+		if (back.offset >= front.offset) { // used space is contiguous
+			if (_capacity - back_end >= size)
+				offset = back_end;
+			else if (front.offset >= size) // wrap around
+				offset = 0;
+			else
+				return std::nullopt;
+		}
+		else { // used space wraps around
+			if (front.offset - back_end >= size)
+				offset = back_end;
+			else
+				return std::nullopt;
+		}
+	}
+	_regions.push_back({offset, size, false});
+	return offset;
+}
+
+void SharedMemoryRing::release(std::size_t offset)
+{
+	std::lock_guard lock(_mutex);
+	auto it = std::ranges::find(_regions, offset, &region_t::offset);
+	if (it == _regions.end())
+		return;
+	it->released = true;
+	while (!_regions.empty() && _regions.front().released)
+		_regions.pop_front();
+}
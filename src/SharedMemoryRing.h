@@ -0,0 +1,72 @@
+/*
+ * Copyright 2024 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef SHARED_MEMORY_RING_H
+#define SHARED_MEMORY_RING_H
+
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+
+// Read-only view on a shared memory segment filled by another process.
+//
+// Regions are allocated contiguously in a ring and must be released once
+// the data was copied out. Allocation fails instead of waiting when there
+// is not enough space.
+class SharedMemoryRing
+{
+public:
+	// Create and map a new shared memory segment, throws on failure
+	SharedMemoryRing(std::size_t capacity);
+	~SharedMemoryRing();
+
+	SharedMemoryRing(const SharedMemoryRing &) = delete;
+	SharedMemoryRing &operator=(const SharedMemoryRing &) = delete;
+
+	const std::string &name() const { return _name; }
+	std::size_t capacity() const { return _capacity; }
+
+	// Remove the name once the other process has opened the segment
+	void unlink();
+
+	std::optional<std::size_t> allocate(std::size_t size);
+	void release(std::size_t offset);
+
+	std::span<const uint8_t> data(std::size_t offset, std::size_t size) const
+	{
+		return {_data + offset, size};
+	}
+
+private:
+	std::string _name;
+	std::size_t _capacity;
+	const uint8_t *_data;
+	bool _linked;
+
+	struct region_t {
+		std::size_t offset, size;
+		bool released;
+	};
+	std::mutex _mutex;
+	std::deque<region_t> _regions; // in allocation order
+};
+
+#endif
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2024 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "SharedMemoryRing.h"
+
+#include <atomic>
+#include <system_error>
+
+extern "C" {
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+}
+
+static std::atomic<unsigned int> ring_count = 0;
+
+SharedMemoryRing::SharedMemoryRing(std::size_t capacity):
+	_name("/workdetailtest-" + std::to_string(getpid()) + "-" + std::to_string(ring_count++)),
+	_capacity(capacity),
+	_data(nullptr),
+	_linked(false)
+{
+	int fd = shm_open(_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd == -1)
+		throw std::system_error(errno, std::system_category(), "shm_open");
+	_linked = true;
+	if (ftruncate(fd, _capacity) == -1) {
+		auto err = errno;
+		close(fd);
+		unlink();
+		throw std::system_error(err, std::system_category(), "ftruncate");
+	}
+	auto addr = mmap(nullptr, _capacity, PROT_READ, MAP_SHARED, fd, 0);
+	auto err = errno;
+	close(fd);
+	if (addr == MAP_FAILED) {
+		unlink();
+		throw std::system_error(err, std::system_category(), "mmap");
+	}
+	_data = static_cast<const uint8_t *>(addr);
+}
+
+SharedMemoryRing::~SharedMemoryRing()
+{
+	if (_data)
+		munmap(const_cast<uint8_t *>(_data), _capacity);
+	unlink();
+}
+
+void SharedMemoryRing::unlink()
+{
+	if (_linked) {
+		shm_unlink(_name.c_str());
+		_linked = false;
+	}
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright 2024 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "SharedMemoryRing.h"
+
+#include <stdexcept>
+
+SharedMemoryRing::SharedMemoryRing(std::size_t capacity):
+	_capacity(capacity),
+	_data(nullptr),
+	_linked(false)
+{
+	throw std::runtime_error("Shared memory is not supported on this platform");
+}
+
+SharedMemoryRing::~SharedMemoryRing()
+{
+}
+
+void SharedMemoryRing::unlink()
+{
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2024 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "SkillMatrix.h"
+
+#include "df/types.h"
+
+#include <algorithm>
+#include <limits>
+
+SkillMatrix::SkillMatrix()
+{
+}
+
+SkillMatrix::~SkillMatrix()
+{
+}
+
+std::size_t SkillMatrix::addRow()
+{
+	if (!_free_rows.empty()) {
+		auto row = _free_rows.back();
+		_free_rows.pop_back();
+		return row;
+	}
+	auto row = _ratings.size() / SkillCount;
+	_ratings.resize(_ratings.size() + SkillCount, -1);
+	_rusty.resize(_rusty.size() + SkillCount, 0);
+	_experience.resize(_experience.size() + SkillCount, 0);
+	return row;
+}
+
+void SkillMatrix::removeRow(std::size_t row)
+{
+	setRow(row, nullptr);
+	_free_rows.push_back(row);
+}
+
+void SkillMatrix::setRow(std::size_t row, const df::unit_soul *soul)
+{
+	auto begin = row * SkillCount;
+	std::fill_n(_ratings.begin() + begin, SkillCount, -1);
+	std::fill_n(_rusty.begin() + begin, SkillCount, 0);
+	std::fill_n(_experience.begin() + begin, SkillCount, 0);
+	if (!soul)
+		return;
+	for (const auto &skill: soul->skills) {
+		if (skill->id < 0 || std::size_t(skill->id) >= SkillCount)
+			continue;
+		auto i = begin + skill->id;
+		_ratings[i] = std::clamp<int>(skill->rating, 0, std::numeric_limits<int8_t>::max());
+		_rusty[i] = std::clamp<int>(skill->rusty, 0, std::numeric_limits<int8_t>::max());
+		_experience[i] = skill->experience;
+	}
+}
+
+int SkillMatrix::ratingWithRust(std::size_t row, df::job_skill_t skill) const
+{
+	auto i = index(row, skill);
+	if (_ratings[i] < 0)
+		return -1;
+	return std::max(_ratings[i] - _rusty[i], 0);
+}
+
+int SkillMatrix::totalExperience(std::size_t row, df::job_skill_t skill) const
+{
+	auto i = index(row, skill);
+	if (_ratings[i] < 0)
+		return -1;
+	return df::unit_skill::cumulated_experience(_ratings[i]) + _experience[i];
+}
+
+int SkillMatrix::maxRating(std::size_t row, std::span<const df::job_skill_t> skills) const
+{
+	const int8_t *ratings = _ratings.data() + row * SkillCount;
+	int8_t best = -1;
+	for (auto skill: skills)
+		best = std::max(best, ratings[skill]);
+	return best;
+}
+
+std::vector<df::job_skill_t> SkillMatrix::laborSkills(std::span<const bool, df::unit_labor::Count> labors)
+{
+	std::vector<df::job_skill_t> skills;
+	for (std::size_t i = 0; i < SkillCount; ++i) {
+		auto skill = static_cast<df::job_skill_t>(i);
+		auto skill_labor = labor(skill);
+		if (skill_labor != df::unit_labor::NONE && labors[skill_labor])
+			skills.push_back(skill);
+	}
+	return skills;
+}
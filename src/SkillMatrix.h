@@ -0,0 +1,84 @@
+/*
+ * Copyright 2024 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef SKILL_MATRIX_H
+#define SKILL_MATRIX_H
+
+#include <QtGlobal>
+
+#include <span>
+#include <vector>
+
+#include "df_enums.h"
+
+namespace df { struct unit_soul; }
+
+// Dense skill values for all units, one row per unit and one column per
+// job_skill. Rows are owned by Unit objects and filled when they are
+// refreshed.
+class SkillMatrix
+{
+public:
+	static constexpr std::size_t SkillCount = df::job_skill::Count;
+
+	SkillMatrix();
+	~SkillMatrix();
+
+	std::size_t addRow();
+	void removeRow(std::size_t row);
+	void setRow(std::size_t row, const df::unit_soul *soul);
+
+	// -1 if the unit does not have the skill
+	int rating(std::size_t row, df::job_skill_t skill) const
+	{
+		return _ratings[index(row, skill)];
+	}
+	int rusty(std::size_t row, df::job_skill_t skill) const
+	{
+		return _rusty[index(row, skill)];
+	}
+	int experience(std::size_t row, df::job_skill_t skill) const
+	{
+		return _experience[index(row, skill)];
+	}
+	// -1 if the unit does not have the skill
+	int ratingWithRust(std::size_t row, df::job_skill_t skill) const;
+	// Experience including previous levels, -1 if the unit does not have the skill
+	int totalExperience(std::size_t row, df::job_skill_t skill) const;
+
+	// Best rating among skills, -1 if the unit has none of them
+	int maxRating(std::size_t row, std::span<const df::job_skill_t> skills) const;
+
+	// Skills used by any of the enabled labors
+	static std::vector<df::job_skill_t> laborSkills(std::span<const bool, df::unit_labor::Count> labors);
+
+private:
+	static std::size_t index(std::size_t row, df::job_skill_t skill)
+	{
+		Q_ASSERT(skill >= 0 && std::size_t(skill) < SkillCount);
+		return row * SkillCount + skill;
+	}
+
+	std::vector<int8_t> _ratings;
+	std::vector<int8_t> _rusty;
+	std::vector<int32_t> _experience;
+	std::vector<std::size_t> _free_rows;
+};
+
+#endif
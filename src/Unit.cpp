@@ -21,6 +21,8 @@
 #include "DwarfFortressData.h"
 #include "ObjectList.h"
 #include <QCoroFuture>
+#include <QRegularExpression>
+#include <cstring>
 #include "df/utils.h"
 #include "LogCategory.h"
 
@@ -39,22 +41,118 @@ static const DFHack::Function<
 Unit::Unit(std::unique_ptr<df::unit> &&unit, DwarfFortressData &df, QObject *parent):
 	QObject(parent),
 	_u(std::move(unit)),
-	_df(df)
+	_df(df),
+	_skill_row(df.skills.addRow())
 {
 	refresh();
 }
 
 Unit::~Unit()
 {
+	_df.skills.removeRow(_skill_row);
 }
 
-void Unit::update(std::unique_ptr<df::unit> &&unit)
-{
+template <typename T>
+static bool sameBits(const T &a, const T &b)
+{
+	return std::memcmp(&a, &b, sizeof(T)) == 0;
+}
+
+static bool sameSoulSkills(const df::unit_soul *a, const df::unit_soul *b)
+{
+	if (!a || !b)
+		return !a && !b;
+	return std::ranges::equal(a->skills, b->skills, [](const auto &a, const auto &b) {
+		return a->id == b->id
+			&& a->rating == b->rating
+			&& a->experience == b->experience
+			&& a->rusty == b->rusty;
+	});
+}
+
+static bool sameSoulAttributes(const df::unit_soul *a, const df::unit_soul *b)
+{
+	if (!a || !b)
+		return !a && !b;
+	return a->mental_attrs == b->mental_attrs;
+}
+
+static Unit::Changes compareUnits(const df::unit &a, const df::unit &b)
+{
+	Unit::Changes changes = 0;
+	if (a.name != b.name)
+		changes |= Unit::NameChanged;
+	if (!sameBits(a.flags1, b.flags1)
+			|| !sameBits(a.flags2, b.flags2)
+			|| !sameBits(a.flags3, b.flags3)
+			|| !sameBits(a.flags4, b.flags4))
+		changes |= Unit::FlagsChanged;
+	if (a.labors != b.labors)
+		changes |= Unit::LaborsChanged;
+	if (!sameSoulSkills(a.current_soul.get(), b.current_soul.get()))
+		changes |= Unit::SkillsChanged;
+	if (a.physical_attrs != b.physical_attrs
+			|| !sameSoulAttributes(a.current_soul.get(), b.current_soul.get())
+			|| bool(a.curse.attr_change) != bool(b.curse.attr_change)
+			|| (a.curse.attr_change && *a.curse.attr_change != *b.curse.attr_change))
+		changes |= Unit::AttributesChanged;
+	// time_on_site is not compared: it changes every tick but derived
+	// values (arrival time) do not.
+	if (a.profession != b.profession
+			|| a.race != b.race
+			|| a.caste != b.caste
+			|| a.civ_id != b.civ_id
+			|| a.mood != b.mood
+			|| !sameBits(a.curse.add_tags1, b.curse.add_tags1)
+			|| !sameBits(a.curse.rem_tags1, b.curse.rem_tags1)
+			|| a.undead != b.undead
+			|| a.hist_figure_id != b.hist_figure_id
+			|| !std::ranges::equal(a.occupations, b.occupations, {},
+					&df::occupation::type, &df::occupation::type)
+			|| !std::ranges::equal(a.inventory, b.inventory, [](const auto &a, const auto &b) {
+					return a->mode == b->mode
+						&& bool(a->item) == bool(b->item)
+						&& (!a->item || a->item->id == b->item->id);
+				})
+			|| a.birth_year != b.birth_year
+			|| a.birth_tick != b.birth_tick
+			|| a.pet_owner != b.pet_owner)
+		changes |= Unit::OtherChanged;
+	return changes;
+}
+
+Unit::Changes Unit::update(std::unique_ptr<df::unit> &&unit)
+{
+	auto changes = compareUnits(*_u, *unit);
+	// Derived values may also change with the game data or time
+	auto old_display_name = std::move(_display_name);
+	auto old_predicates = _predicates;
+	bool was_baby = isBaby(), was_child = isChild();
 	_u = std::move(unit);
 	refresh();
+	if (_display_name != old_display_name)
+		changes |= NameChanged;
+	if (!(_predicates == old_predicates) || isBaby() != was_baby || isChild() != was_child)
+		changes |= OtherChanged;
+	_changes = changes;
+	return changes;
 }
 
 void Unit::refresh()
+{
+	refreshPredicates();
+	_df.skills.setRow(_skill_row, _u->current_soul.get());
+	refreshDisplayName();
+	_search_name = searchKey(_display_name);
+}
+
+QString Unit::searchKey(const QString &text)
+{
+	static const QRegularExpression marks("\\p{M}");
+	return text.normalized(QString::NormalizationForm_KD).remove(marks).toCaseFolded();
+}
+
+void Unit::refreshDisplayName()
 {
 	using df::fromCP437;
 	if (!_df.raws) {
@@ -85,6 +183,34 @@ void Unit::refresh()
 	}
 }
 
+void Unit::refreshPredicates()
+{
+	static_assert([]() {
+		for (auto category: {Category::Citizens, Category::PetsOrLivestock,
+				Category::Others, Category::Dead, Category::Invisible}) {
+			Predicates predicates = {};
+			predicates.category = category;
+			if (predicates.category != category)
+				return false;
+		}
+		return true;
+	}(), "every Category must round-trip through Predicates::category");
+	// Order matters: check functions use previously computed predicates
+	_predicates.crazed = checkCrazed();
+	_predicates.opposed_to_life = checkOpposedToLife();
+	_predicates.fort_controlled = checkFortControlled();
+	_predicates.tamable = checkTamable();
+	_predicates.own_group = checkOwnGroup();
+	_predicates.can_learn = checkCanLearn();
+	_predicates.can_speak = checkCanSpeak();
+	_predicates.menial_work_exemption = checkMenialWorkExemption();
+	_predicates.can_assign_work = checkCanAssignWork();
+	_predicates.can_be_adopted = checkCanBeAdopted();
+	_predicates.can_be_slaughtered = checkCanBeSlaughtered();
+	_predicates.can_be_gelded = checkCanBeGelded();
+	_predicates.category = checkCategory();
+}
+
 const df::creature_raw *Unit::creature_raw() const
 {
 	if (!_df.raws || _u->race < 0 || unsigned(_u->race) > _df.raws->creatures.all.size())
@@ -199,7 +325,7 @@ int Unit::attributeCasteRating(T attr) const
 template int Unit::attributeCasteRating<df::physical_attribute_type_t>(df::physical_attribute_type_t) const;
 template int Unit::attributeCasteRating<df::mental_attribute_type_t>(df::mental_attribute_type_t) const;
 
-bool Unit::isFortControlled() const
+bool Unit::checkFortControlled() const
 {
 	// if (gamemode != DWARF) return false;
 	if (_u->mood == df::mood_type::Berserk
@@ -226,7 +352,7 @@ bool Unit::isFortControlled() const
 	return _u->civ_id != -1 && _u->civ_id == _df.current_civ_id;
 }
 
-bool Unit::isCrazed() const
+bool Unit::checkCrazed() const
 {
 	if (_u->flags3.bits.scuttle)
 		return false;
@@ -237,7 +363,7 @@ bool Unit::isCrazed() const
 	return hasCasteFlag(df::caste_raw_flags::CRAZED);
 }
 
-bool Unit::isOpposedToLife() const
+bool Unit::checkOpposedToLife() const
 {
 	if (_u->curse.rem_tags1.bits.OPPOSED_TO_LIFE)
 		return false;
@@ -246,7 +372,7 @@ bool Unit::isOpposedToLife() const
 	return hasCasteFlag(df::caste_raw_flags::OPPOSED_TO_LIFE);
 }
 
-bool Unit::canLearn() const
+bool Unit::checkCanLearn() const
 {
 	if (_u->curse.rem_tags1.bits.CAN_LEARN)
 		return false;
@@ -255,7 +381,7 @@ bool Unit::canLearn() const
 	return hasCasteFlag(df::caste_raw_flags::CAN_LEARN);
 }
 
-bool Unit::canSpeak() const
+bool Unit::checkCanSpeak() const
 {
 	if (_u->curse.rem_tags1.bits.CAN_SPEAK)
 		return false;
@@ -264,7 +390,7 @@ bool Unit::canSpeak() const
 	return hasCasteFlag(df::caste_raw_flags::CAN_SPEAK);
 }
 
-bool Unit::isOwnGroup() const
+bool Unit::checkOwnGroup() const
 {
 	if (auto hf = df::find(_df.histfigs, _u->hist_figure_id))
 		return std::ranges::any_of(hf->entity_links, [this](const auto &link) {
@@ -275,7 +401,7 @@ bool Unit::isOwnGroup() const
 		return false;
 }
 
-bool Unit::canAssignWork() const
+bool Unit::checkCanAssignWork() const
 {
 	if (_u->flags1.bits.inactive)
 		return false;
@@ -320,14 +446,14 @@ bool Unit::isAdult() const
 		&& _u->profession != df::profession::CHILD;
 }
 
-bool Unit::isTamable() const
+bool Unit::checkTamable() const
 {
 	return hasCasteFlag(
 			df::caste_raw_flags::PET,
 			df::caste_raw_flags::PET_EXOTIC);
 }
 
-bool Unit::hasMenialWorkExemption() const
+bool Unit::checkMenialWorkExemption() const
 {
 	auto match_position = [](const DwarfFortressData &df, const df::historical_figure &hf, df::entity_position_flags_t flag) {
 		for (const auto &link: hf.entity_links) {
@@ -364,7 +490,7 @@ bool Unit::hasMenialWorkExemption() const
 	return false;
 }
 
-bool Unit::canBeAdopted() const
+bool Unit::checkCanBeAdopted() const
 {
 	if (!_u->flags1.bits.tame)
 		return false;
@@ -373,19 +499,19 @@ bool Unit::canBeAdopted() const
 	return !hasCasteFlag(df::caste_raw_flags::ADOPTS_OWNER);
 }
 
-bool Unit::canBeSlaughtered() const
+bool Unit::checkCanBeSlaughtered() const
 {
 	return _u->pet_owner == -1;
 }
 
-bool Unit::canBeGelded() const
+bool Unit::checkCanBeGelded() const
 {
 	if (_u->flags3.bits.ghostly || _u->flags3.bits.gelded || _u->undead)
 		return false;
 	return hasCasteFlag(df::caste_raw_flags::GELDABLE);
 }
 
-Unit::Category Unit::category() const
+Unit::Category Unit::checkCategory() const
 {
 	if (_u->flags1.bits.left || _u->flags1.bits.incoming)
 		return Category::Invisible;
@@ -402,7 +528,6 @@ Unit::Category Unit::category() const
 		return Category::Citizens;
 	else
 		return Category::PetsOrLivestock;
-
 }
 
 static auto toProto(Unit::Flag flag)
@@ -450,9 +575,11 @@ void Unit::Properties::setArgs(dfproto::workdetailtest::UnitProperties &args) co
 
 void Unit::setProperties(const Properties &properties, const dfproto::workdetailtest::UnitResult &results)
 {
+	_changes = 0;
 	if (properties.nickname) {
 		_u->name.nickname = df::toCP437(*properties.nickname);
 		refresh();
+		_changes |= NameChanged;
 	}
 	for (const auto &flag_result: results.flags()) {
 		auto flag = fromProto(flag_result.flag());
@@ -493,7 +620,10 @@ void Unit::setProperties(const Properties &properties, const dfproto::workdetail
 				_u->flags2.bits.slaughter = false;
 			break;
 		}
+		_changes |= FlagsChanged | OtherChanged;
 	}
+	if (_changes & FlagsChanged)
+		refreshPredicates();
 }
 
 QCoro::Task<> Unit::edit(Properties changes)
@@ -519,6 +649,7 @@ QCoro::Task<> Unit::edit(Properties changes)
 		qCCritical(DFHackLog) << "EditUnit failed" << r->unit().error();
 		co_return;
 	}
+	_df.units->aboutToUpdate();
 	setProperties(changes, *r);
 	_df.units->updated(_df.units->find(*this));
 }
@@ -543,6 +674,7 @@ QCoro::Task<> Unit::edit(std::shared_ptr<DwarfFortressData> df, std::vector<std:
 		qCCritical(DFHackLog) << "EditUnit failed" << make_error_code(r.cr).message();
 		co_return;
 	}
+	df->units->aboutToUpdate();
 	for (std::size_t i = 0; i < units.size(); ++i) {
 		auto unit_result = r->results(i);
 		if (!unit_result.unit().success()) {
@@ -576,6 +708,7 @@ QCoro::Task<> Unit::toggle(std::shared_ptr<DwarfFortressData> df, std::vector<st
 		qCCritical(DFHackLog) << "EditUnit failed" << make_error_code(r.cr).message();
 		co_return;
 	}
+	df->units->aboutToUpdate();
 	for (std::size_t i = 0; i < units.size(); ++i) {
 		auto unit_result = r->results(i);
 		if (!unit_result.unit().success()) {
@@ -43,13 +43,35 @@ public:
 	using df_type = df::unit;
 	static inline constexpr auto sorted_key = &df::unit::id;
 
-	void update(std::unique_ptr<df::unit> &&unit);
+	// Fields that changed in the last update
+	enum Change: unsigned {
+		NameChanged = 1 << 0,
+		FlagsChanged = 1 << 1,
+		LaborsChanged = 1 << 2,
+		SkillsChanged = 1 << 3,
+		AttributesChanged = 1 << 4,
+		OtherChanged = 1 << 5, // other fields or derived predicates
+		AllChanged = (1 << 6) - 1,
+	};
+	using Changes = unsigned;
+
+	Changes update(std::unique_ptr<df::unit> &&unit);
+	// Changes from the last update or property edit
+	Changes lastChanges() const { return _changes; }
 
+	const DwarfFortressData &data() const { return _df; }
 	const df::unit *get() const { return _u.get(); }
 	const df::unit &operator*() const { return *_u; }
 	const df::unit *operator->() const { return _u.get(); }
 
 	const QString &displayName() const { return _display_name; }
+	// displayName converted with searchKey, computed in refresh
+	const QString &searchName() const { return _search_name; }
+	// Decompose text, remove combining marks and fold case so that names
+	// can be matched regardless of accents and case.
+	static QString searchKey(const QString &text);
+	// Row in DwarfFortressData::skills
+	std::size_t skillRow() const { return _skill_row; }
 
 	const df::creature_raw *creature_raw() const;
 	const df::caste_raw *caste_raw() const;
@@ -88,30 +110,32 @@ public:
 	}
 
 
-	bool isFortControlled() const;
-	bool isCrazed() const;
-	bool isOpposedToLife() const;
-	bool isOwnGroup() const;
-	bool canLearn() const;
-	bool canSpeak() const;
-	bool canAssignWork() const;
-	bool isTamable() const;
+	// Derived predicates are computed in refresh (see Predicates)
+	bool isFortControlled() const { return _predicates.fort_controlled; }
+	bool isCrazed() const { return _predicates.crazed; }
+	bool isOpposedToLife() const { return _predicates.opposed_to_life; }
+	bool isOwnGroup() const { return _predicates.own_group; }
+	bool canLearn() const { return _predicates.can_learn; }
+	bool canSpeak() const { return _predicates.can_speak; }
+	bool canAssignWork() const { return _predicates.can_assign_work; }
+	bool isTamable() const { return _predicates.tamable; }
 	bool isBaby() const;
 	bool isChild() const;
 	bool isAdult() const;
-	bool hasMenialWorkExemption() const;
-	bool canBeAdopted() const;
-	bool canBeSlaughtered() const;
-	bool canBeGelded() const;
+	bool hasMenialWorkExemption() const { return _predicates.menial_work_exemption; }
+	bool canBeAdopted() const { return _predicates.can_be_adopted; }
+	bool canBeSlaughtered() const { return _predicates.can_be_slaughtered; }
+	bool canBeGelded() const { return _predicates.can_be_gelded; }
 
-	enum class Category {
+	// Unsigned so that all values fit in Predicates::category
+	enum class Category: uint8_t {
 		Citizens,
 		PetsOrLivestock,
 		Others,
 		Dead,
 		Invisible,
 	};
-	Category category() const;
+	Category category() const { return _predicates.category; }
 
 	enum class Flag {
 		OnlyDoAssignedJobs,
@@ -161,12 +185,53 @@ public:
 
 private:
 	void refresh();
+	void refreshDisplayName();
+	void refreshPredicates();
 	void setProperties(const Properties &properties, const dfproto::workdetailtest::UnitResult &results);
 
+	// Compute predicates, may use the cached value of the predicates
+	// computed before them in refreshPredicates.
+	bool checkFortControlled() const;
+	bool checkCrazed() const;
+	bool checkOpposedToLife() const;
+	bool checkOwnGroup() const;
+	bool checkCanLearn() const;
+	bool checkCanSpeak() const;
+	bool checkCanAssignWork() const;
+	bool checkTamable() const;
+	bool checkMenialWorkExemption() const;
+	bool checkCanBeAdopted() const;
+	bool checkCanBeSlaughtered() const;
+	bool checkCanBeGelded() const;
+	Category checkCategory() const;
+
 	std::unique_ptr<df::unit> _u;
 	DwarfFortressData &_df;
 
 	QString _display_name;
+	QString _search_name;
+	std::size_t _skill_row;
+	Changes _changes = AllChanged;
+
+	// Predicates depending on the unit and the histfig/entity/raws data,
+	// all of them are updated together by every DwarfFortressData refresh.
+	struct Predicates {
+		bool fort_controlled: 1;
+		bool crazed: 1;
+		bool opposed_to_life: 1;
+		bool own_group: 1;
+		bool can_learn: 1;
+		bool can_speak: 1;
+		bool can_assign_work: 1;
+		bool tamable: 1;
+		bool menial_work_exemption: 1;
+		bool can_be_adopted: 1;
+		bool can_be_slaughtered: 1;
+		bool can_be_gelded: 1;
+		Category category: 3;
+
+		bool operator==(const Predicates &) const = default;
+	} _predicates;
 };
 
 extern template const df::unit_attribute *Unit::attribute<df::physical_attribute_type_t>(df::physical_attribute_type_t) const;
@@ -75,6 +75,7 @@ Dock::Dock(std::shared_ptr<const DwarfFortressData> df, QWidget *parent):
 
 	auto inventory_model = new InventoryModel(*_df, this);
 	[[maybe_unused]] auto inventory_view = make_view(tr("Inventory"), inventory_model);
+	_inventory_tab = _ui->tabs->indexOf(inventory_view);
 }
 
 Dock::~Dock()
@@ -112,3 +113,8 @@ void Dock::setUnit(const Unit *unit)
 		view->header()->resizeSections(QHeaderView::ResizeToContents);
 }
 
+void Dock::setInventoryAvailable(bool available)
+{
+	_ui->tabs->setTabVisible(_inventory_tab, available);
+}
+
@@ -41,12 +41,14 @@ public:
 
 public slots:
 	void setUnit(const Unit *unit);
+	void setInventoryAvailable(bool available);
 
 private:
 	std::unique_ptr<Ui::UnitDetailsDock> _ui;
 	std::shared_ptr<const DwarfFortressData> _df;
 	std::vector<UnitDataModel *> _models;
 	std::vector<QTreeView *> _views;
+	int _inventory_tab;
 	QMetaObject::Connection _current_unit_destroyed;
 };
 
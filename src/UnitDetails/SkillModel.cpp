@@ -20,6 +20,7 @@
 
 #include "Unit.h"
 #include "DataRole.h"
+#include "DwarfFortressData.h"
 
 using namespace UnitDetails;
 
@@ -67,7 +68,7 @@ QVariant SkillModel::data(const QModelIndex &index, int role) const
 			else
 				return skill->rating;
 		case DataRole::SortRole:
-			return df::unit_skill::cumulated_experience(skill->rating) + skill->experience;
+			return _df.skills.totalExperience(_u->skillRow(), skill->id);
 		case Qt::TextAlignmentRole:
 			return Qt::AlignCenter;
 		case Qt::ToolTipRole: {
@@ -0,0 +1,419 @@
+/*
+ * Copyright 2024 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "UnitFilterCompiler.h"
+
+#include "Unit.h"
+#include "UnitScriptWrapper.h"
+
+#include <cmath>
+#include <functional>
+#include <optional>
+#include <variant>
+
+namespace {
+
+template <typename T>
+using unit_fn = std::function<T(const Unit &)>;
+// Typed expression node, the type is checked at compile time
+using node_t = std::variant<unit_fn<bool>, unit_fn<double>, unit_fn<QString>>;
+
+struct token_t
+{
+	enum Type {
+		End,
+		Identifier,
+		Number,
+		String,
+		Operator,
+	} type;
+	QString text;
+	double number = 0.0;
+};
+
+// Longer operators must come first
+static const QString Operators[] = {
+	"===", "!==",
+	"==", "!=", "<=", ">=", "&&", "||", "=>",
+	"<", ">", "!", "-", "(", ")", ".",
+};
+
+static std::optional<std::vector<token_t>> tokenize(QStringView text)
+{
+	std::vector<token_t> tokens;
+	qsizetype i = 0;
+	auto is_identifier_start = [](QChar c) {
+		return c.isLetter() || c == '_' || c == '$';
+	};
+	while (i < text.size()) {
+		auto c = text[i];
+		if (c.isSpace()) {
+			++i;
+		}
+		else if (is_identifier_start(c)) {
+			auto begin = i;
+			while (i < text.size() && (is_identifier_start(text[i]) || text[i].isDigit()))
+				++i;
+			tokens.push_back({token_t::Identifier, text.sliced(begin, i-begin).toString()});
+		}
+		else if (c.isDigit()) {
+			auto begin = i;
+			while (i < text.size() && (text[i].isDigit() || text[i] == '.'))
+				++i;
+			bool ok;
+			double value = text.sliced(begin, i-begin).toDouble(&ok);
+			if (!ok)
+				return std::nullopt;
+			tokens.push_back({token_t::Number, {}, value});
+		}
+		else if (c == '"' || c == '\'') {
+			QString str;
+			for (++i; i < text.size() && text[i] != c; ++i) {
+				if (text[i] == '\\') {
+					if (++i == text.size())
+						return std::nullopt;
+					switch (text[i].unicode()) {
+					case '\\': case '\'': case '"':
+						str.append(text[i]);
+						break;
+					case 'n':
+						str.append('\n');
+						break;
+					default: // other escape sequences are not supported
+						return std::nullopt;
+					}
+				}
+				else
+					str.append(text[i]);
+			}
+			if (i == text.size())
+				return std::nullopt;
+			++i; // closing quote
+			tokens.push_back({token_t::String, std::move(str)});
+		}
+		else {
+			auto op = std::ranges::find_if(Operators, [&](const QString &op) {
+				return text.sliced(i).startsWith(op);
+			});
+			if (op == std::end(Operators))
+				return std::nullopt;
+			tokens.push_back({token_t::Operator, *op});
+			i += op->size();
+		}
+	}
+	tokens.push_back({token_t::End});
+	return tokens;
+}
+
+static const std::map<QString, node_t> UnitProperties = {
+	{"name", unit_fn<QString>(&Unit::displayName)},
+	{"race_name", unit_fn<QString>([](const Unit &unit) { return UnitScriptWrapper::raceName(unit); })},
+	{"caste_name", unit_fn<QString>([](const Unit &unit) { return UnitScriptWrapper::casteName(unit); })},
+	{"profession", unit_fn<double>([](const Unit &unit) { return double(unit->profession); })},
+};
+
+static const std::map<QString, unit_fn<bool>> UnitMethods = {
+	{"isFortControlled", &Unit::isFortControlled},
+	{"isCrazed", &Unit::isCrazed},
+	{"isOpposedToLife", &Unit::isOpposedToLife},
+	{"isOwnGroup", &Unit::isOwnGroup},
+	{"canLearn", &Unit::canLearn},
+	{"canSpeak", &Unit::canSpeak},
+	{"canAssignWork", &Unit::canAssignWork},
+	{"isTamable", &Unit::isTamable},
+	{"isBaby", &Unit::isBaby},
+	{"isChild", &Unit::isChild},
+	{"isAdult", &Unit::isAdult},
+	{"hasMenialWorkExemption", &Unit::hasMenialWorkExemption},
+};
+
+static bool isBool(const node_t &node)
+{
+	return std::holds_alternative<unit_fn<bool>>(node);
+}
+
+// Convert like Boolean()
+static unit_fn<bool> toBool(node_t node)
+{
+	return std::visit([](auto &&f) -> unit_fn<bool> {
+		using T = std::invoke_result_t<decltype(f), const Unit &>;
+		if constexpr (std::is_same_v<T, bool>)
+			return f;
+		else if constexpr (std::is_same_v<T, double>)
+			return [f](const Unit &unit) {
+				auto value = f(unit);
+				return value != 0.0 && !std::isnan(value);
+			};
+		else
+			return [f](const Unit &unit) { return !f(unit).isEmpty(); };
+	}, std::move(node));
+}
+
+class Parser
+{
+public:
+	Parser(std::vector<token_t> &&tokens, const std::map<QString, UnitFilterCompiler::enum_values_t> &enums):
+		_tokens(std::move(tokens)),
+		_pos(0),
+		_enums(enums)
+	{
+	}
+
+	// Parse "(name) =>" or "name =>" and return the parameter name
+	std::optional<QString> parseParameter()
+	{
+		bool parenthesis = accept("(");
+		if (peek().type != token_t::Identifier)
+			return std::nullopt;
+		auto name = next().text;
+		if (parenthesis && !accept(")"))
+			return std::nullopt;
+		if (!accept("=>"))
+			return std::nullopt;
+		return name;
+	}
+
+	// Parse the remaining tokens as a single expression
+	UnitFilter parseFilter(const QString &unit_name)
+	{
+		_unit_name = unit_name;
+		auto node = parseOr();
+		if (!node || peek().type != token_t::End)
+			return {};
+		return toBool(std::move(*node));
+	}
+
+private:
+	const token_t &peek() const { return _tokens[_pos]; }
+	const token_t &next() { return _tokens[_pos++]; }
+
+	bool accept(const QString &op)
+	{
+		if (peek().type == token_t::Operator && peek().text == op) {
+			++_pos;
+			return true;
+		}
+		return false;
+	}
+
+	std::optional<node_t> parseOr()
+	{
+		auto left = parseAnd();
+		while (left && accept("||")) {
+			auto right = parseAnd();
+			if (!right || !isBool(*left) || !isBool(*right))
+				return std::nullopt; // || returns one of its operands, only bool operands are typed as bool
+			left = unit_fn<bool>([l = std::get<unit_fn<bool>>(std::move(*left)), r = std::get<unit_fn<bool>>(std::move(*right))](const Unit &unit) {
+				return l(unit) || r(unit);
+			});
+		}
+		return left;
+	}
+
+	std::optional<node_t> parseAnd()
+	{
+		auto left = parseEquality();
+		while (left && accept("&&")) {
+			auto right = parseEquality();
+			if (!right || !isBool(*left) || !isBool(*right))
+				return std::nullopt; // same as ||
+			left = unit_fn<bool>([l = std::get<unit_fn<bool>>(std::move(*left)), r = std::get<unit_fn<bool>>(std::move(*right))](const Unit &unit) {
+				return l(unit) && r(unit);
+			});
+		}
+		return left;
+	}
+
+	template <typename Compare>
+	static std::optional<node_t> compare(node_t left, node_t right, Compare cmp, bool allow_bool)
+	{
+		if (left.index() != right.index())
+			return std::nullopt; // implicit conversions are not supported
+		return std::visit([&](auto &&l) -> std::optional<node_t> {
+			using F = std::remove_cvref_t<decltype(l)>;
+			using T = std::invoke_result_t<F, const Unit &>;
+			if constexpr (std::is_same_v<T, bool>)
+				if (!allow_bool)
+					return std::nullopt;
+			auto r = std::get<F>(std::move(right));
+			return unit_fn<bool>([l, r, cmp](const Unit &unit) {
+				return cmp(l(unit), r(unit));
+			});
+		}, std::move(left));
+	}
+
+	std::optional<node_t> parseEquality()
+	{
+		auto left = parseRelational();
+		if (!left)
+			return std::nullopt;
+		// Same types only, so == and === are the same
+		bool equal = accept("==") || accept("===");
+		if (!equal && !accept("!=") && !accept("!=="))
+			return left;
+		auto right = parseRelational();
+		if (!right)
+			return std::nullopt;
+		if (equal)
+			return compare(std::move(*left), std::move(*right), std::equal_to{}, true);
+		else
+			return compare(std::move(*left), std::move(*right), std::not_equal_to{}, true);
+	}
+
+	std::optional<node_t> parseRelational()
+	{
+		auto left = parseUnary();
+		if (!left)
+			return std::nullopt;
+		auto make = [&, this](auto cmp) -> std::optional<node_t> {
+			auto right = parseUnary();
+			if (!right)
+				return std::nullopt;
+			return compare(std::move(*left), std::move(*right), cmp, false);
+		};
+		if (accept("<="))
+			return make(std::less_equal{});
+		else if (accept(">="))
+			return make(std::greater_equal{});
+		else if (accept("<"))
+			return make(std::less{});
+		else if (accept(">"))
+			return make(std::greater{});
+		else
+			return left;
+	}
+
+	std::optional<node_t> parseUnary()
+	{
+		if (accept("!")) {
+			auto operand = parseUnary();
+			if (!operand)
+				return std::nullopt;
+			return unit_fn<bool>([f = toBool(std::move(*operand))](const Unit &unit) {
+				return !f(unit);
+			});
+		}
+		if (accept("-")) {
+			auto operand = parseUnary();
+			if (!operand || !std::holds_alternative<unit_fn<double>>(*operand))
+				return std::nullopt;
+			return unit_fn<double>([f = std::get<unit_fn<double>>(std::move(*operand))](const Unit &unit) {
+				return -f(unit);
+			});
+		}
+		return parsePrimary();
+	}
+
+	std::optional<node_t> parsePrimary()
+	{
+		const auto &token = next();
+		switch (token.type) {
+		case token_t::Number:
+			return unit_fn<double>([value = token.number](const Unit &) { return value; });
+		case token_t::String:
+			return unit_fn<QString>([value = token.text](const Unit &) { return value; });
+		case token_t::Operator:
+			if (token.text == "(") {
+				auto node = parseOr();
+				if (!node || !accept(")"))
+					return std::nullopt;
+				return node;
+			}
+			return std::nullopt;
+		case token_t::Identifier:
+			if (token.text == "true" || token.text == "false")
+				return unit_fn<bool>([value = token.text == "true"](const Unit &) { return value; });
+			else if (token.text == _unit_name)
+				return parseUnitMember();
+			else if (auto it = _enums.find(token.text); it != _enums.end())
+				return parseEnumValue(it->second);
+			return std::nullopt;
+		case token_t::End:
+		default:
+			return std::nullopt;
+		}
+	}
+
+	std::optional<node_t> parseUnitMember()
+	{
+		if (!accept(".") || peek().type != token_t::Identifier)
+			return std::nullopt;
+		const auto &member = next().text;
+		if (accept("(")) {
+			auto method = UnitMethods.find(member);
+			if (method == UnitMethods.end() || !accept(")"))
+				return std::nullopt;
+			return method->second;
+		}
+		auto property = UnitProperties.find(member);
+		if (property == UnitProperties.end())
+			return std::nullopt;
+		return property->second;
+	}
+
+	std::optional<node_t> parseEnumValue(const UnitFilterCompiler::enum_values_t &values)
+	{
+		if (!accept(".") || peek().type != token_t::Identifier)
+			return std::nullopt;
+		auto it = values.find(next().text);
+		if (it == values.end())
+			return std::nullopt;
+		return unit_fn<double>([value = double(it->second)](const Unit &) { return value; });
+	}
+
+	std::vector<token_t> _tokens;
+	std::size_t _pos;
+	const std::map<QString, UnitFilterCompiler::enum_values_t> &_enums;
+	QString _unit_name;
+};
+
+} // namespace
+
+UnitFilterCompiler::UnitFilterCompiler()
+{
+}
+
+UnitFilterCompiler::~UnitFilterCompiler()
+{
+}
+
+void UnitFilterCompiler::addEnum(const QString &name, enum_values_t values)
+{
+	_enums.insert_or_assign(name, std::move(values));
+}
+
+UnitFilter UnitFilterCompiler::compileExpression(const QString &expression, const QString &unit_name) const
+{
+	auto tokens = tokenize(expression);
+	if (!tokens)
+		return {};
+	return Parser(std::move(*tokens), _enums).parseFilter(unit_name);
+}
+
+UnitFilter UnitFilterCompiler::compileFunction(const QString &script) const
+{
+	auto tokens = tokenize(script);
+	if (!tokens)
+		return {};
+	Parser parser(std::move(*tokens), _enums);
+	auto unit_name = parser.parseParameter();
+	if (!unit_name)
+		return {};
+	return parser.parseFilter(*unit_name);
+}
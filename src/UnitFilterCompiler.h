@@ -0,0 +1,51 @@
+/*
+ * Copyright 2024 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef UNIT_FILTER_COMPILER_H
+#define UNIT_FILTER_COMPILER_H
+
+#include "UserUnitFilters.h"
+
+#include <map>
+
+// Compiles a subset of the JavaScript filter expressions into native
+// UnitFilter: boolean combinations (!, &&, ||) of unit predicate calls and
+// comparisons of unit properties with literals or enum values. Expressions
+// outside of this subset must be run by the script engine.
+class UnitFilterCompiler
+{
+public:
+	UnitFilterCompiler();
+	~UnitFilterCompiler();
+
+	using enum_values_t = std::map<QString, int>;
+	// Enum objects are global script objects mapping names to values
+	void addEnum(const QString &name, enum_values_t values);
+
+	// Compile expression where unit_name is the unit, returns an empty
+	// filter if the expression is not supported.
+	UnitFilter compileExpression(const QString &expression, const QString &unit_name = "u") const;
+	// Same as compileExpression for "(unit) => expression" scripts
+	UnitFilter compileFunction(const QString &script) const;
+
+private:
+	std::map<QString, enum_values_t> _enums;
+};
+
+#endif
@@ -21,19 +21,57 @@
 #include "Unit.h"
 #include "ObjectList.h"
 
+#include <QtConcurrent>
+
 UnitFilterProxyModel::UnitFilterProxyModel(QObject *parent):
 	QSortFilterProxyModel(parent),
 	_units(nullptr)
 {
+	_user_evaluation_pool.setMaxThreadCount(1);
+	connect(&_user_evaluation_watcher, &QFutureWatcherBase::finished,
+		this, &UnitFilterProxyModel::userEvaluationFinished);
 }
 
 UnitFilterProxyModel::~UnitFilterProxyModel()
 {
+	cancelUserEvaluation();
 }
 
 void UnitFilterProxyModel::setSourceModel(QAbstractItemModel *source_model)
 {
+	cancelUserEvaluation();
+	for (const auto &connection: _source_connections)
+		disconnect(connection);
+	_source_connections.clear();
 	_units = dynamic_cast<ObjectList<Unit> *>(source_model);
+	if (_units) {
+		// Bitmaps must be updated before QSortFilterProxyModel handles
+		// the same signals, connect before setting the source model.
+		_source_connections = {
+			connect(_units, &ObjectListBase::aboutToUpdate,
+				this, &UnitFilterProxyModel::cancelUserEvaluation),
+			connect(_units, &QAbstractItemModel::dataChanged,
+				this, [this](const QModelIndex &top_left, const QModelIndex &bottom_right) {
+					evaluateRows(top_left.row(), bottom_right.row());
+				}),
+			connect(_units, &QAbstractItemModel::rowsInserted,
+				this, [this](const QModelIndex &, int first, int last) {
+					for (auto bitmap: {&_base_accepted, &_user_accepted, &_accepted})
+						bitmap->insert(first, last-first+1);
+					evaluateRows(first, last);
+				}),
+			connect(_units, &QAbstractItemModel::rowsRemoved,
+				this, [this](const QModelIndex &, int first, int last) {
+					for (auto bitmap: {&_base_accepted, &_user_accepted, &_accepted})
+						bitmap->erase(first, last-first+1);
+				}),
+			connect(_units, &QAbstractItemModel::layoutChanged,
+				this, &UnitFilterProxyModel::resetRows),
+			connect(_units, &QAbstractItemModel::modelReset,
+				this, &UnitFilterProxyModel::resetRows),
+		};
+	}
+	resetRows();
 	QSortFilterProxyModel::setSourceModel(_units);
 }
 
@@ -43,7 +81,15 @@ void UnitFilterProxyModel::setUserFilters(std::shared_ptr<const UserUnitFilters>
 		disconnect(_user_filters.get());
 	_user_filters = std::move(user_filters);
 	connect(_user_filters.get(), &UserUnitFilters::invalidated,
-		this, [this]() { invalidateRowsFilter(); });
+		this, &UnitFilterProxyModel::userFiltersChanged);
+	// New filters are applied at once, a running evaluation is discarded
+	++_user_generation;
+	_user_pending = false;
+	if (_units) {
+		int last = _units->rowCount()-1;
+		evaluateUserFilters(0, last);
+		combine(0, last);
+	}
 	invalidateRowsFilter();
 }
 
@@ -68,9 +114,226 @@ bool UnitFilterProxyModel::filterAcceptsRow(int source_row, const QModelIndex &s
 {
 	if (source_parent.isValid())
 		return true;
+	if (std::size_t(source_row) < _accepted.size)
+		return _accepted.test(source_row);
 	if (auto unit = _units->get(source_row))
 		return (!_base_filter || _base_filter(*unit))
 			&& (!_user_filters || (*_user_filters)(*unit));
 	else
 		return true;
 }
+
+void UnitFilterProxyModel::bitmap_t::resize(std::size_t n)
+{
+	size = n;
+	words.resize((n+63)/64);
+}
+
+void UnitFilterProxyModel::bitmap_t::insert(std::size_t pos, std::size_t count)
+{
+	auto old_size = size;
+	resize(size+count);
+	for (auto i = old_size; i-- > pos;)
+		set(i+count, test(i));
+}
+
+void UnitFilterProxyModel::bitmap_t::erase(std::size_t pos, std::size_t count)
+{
+	for (auto i = pos; i+count < size; ++i)
+		set(i, test(i+count));
+	resize(size-count);
+}
+
+void UnitFilterProxyModel::baseFilterChanged()
+{
+	if (_units) {
+		int last = _units->rowCount()-1;
+		evaluateBaseFilter(0, last);
+		combine(0, last);
+	}
+	invalidateRowsFilter();
+}
+
+void UnitFilterProxyModel::userFiltersChanged()
+{
+	++_user_generation;
+	_user_pending = true;
+	if (_user_evaluation)
+		_user_evaluation->cancelled = true; // started again when it returns
+	else
+		startUserEvaluation();
+}
+
+void UnitFilterProxyModel::startUserEvaluation()
+{
+	if (!_units) {
+		_user_pending = false;
+		invalidateRowsFilter();
+		return;
+	}
+	auto evaluation = std::make_shared<user_evaluation_t>();
+	// Scripted filters hold values from the GUI thread engine, the copy
+	// must be deleted in the GUI thread.
+	evaluation->filters = std::shared_ptr<UserUnitFilters>(
+			new UserUnitFilters(*_user_filters),
+			[](UserUnitFilters *filters) { filters->deleteLater(); });
+	evaluation->units = units(0, _units->rowCount()-1);
+	evaluation->generation = _user_generation;
+	_user_evaluation = evaluation;
+	_user_evaluation_watcher.setFuture(QtConcurrent::run(&_user_evaluation_pool, [evaluation]() {
+		std::optional<bitmap_t> bitmap(std::in_place);
+		bitmap->resize(evaluation->units.size());
+		if (!evaluateUserFilters(*bitmap, 0, evaluation->units,
+				*evaluation->filters, &evaluation->cancelled))
+			bitmap.reset();
+		return bitmap;
+	}));
+}
+
+void UnitFilterProxyModel::userEvaluationFinished()
+{
+	auto evaluation = std::exchange(_user_evaluation, nullptr);
+	if (!evaluation)
+		return;
+	auto bitmap = _user_evaluation_watcher.result();
+	if (bitmap && !evaluation->cancelled && evaluation->generation == _user_generation) {
+		_user_accepted = std::move(*bitmap);
+		_user_pending = false;
+		combine(0, _user_accepted.size-1);
+		invalidateRowsFilter();
+		_user_filters->reportFailures();
+	}
+	else if (_user_pending)
+		startUserEvaluation();
+}
+
+void UnitFilterProxyModel::cancelUserEvaluation()
+{
+	if (!_user_evaluation)
+		return;
+	_user_evaluation->cancelled = true;
+	_user_evaluation_watcher.waitForFinished();
+}
+
+bool UnitFilterProxyModel::evaluate(bitmap_t &bitmap, int first,
+		std::span<const Unit *const> units,
+		const UnitFilter &concurrent_filter,
+		const UnitBatchFilter &gui_filter,
+		const std::atomic<bool> *cancelled)
+{
+	if (units.empty())
+		return true;
+	int last = first + units.size() - 1;
+	auto is_cancelled = [cancelled]() { return cancelled && *cancelled; };
+	// Rows are split in blocks matching bitmap words so that each word
+	// is written by a single thread.
+	auto evaluate_word = [&](std::size_t w) {
+		if (is_cancelled())
+			return;
+		auto begin = std::max<std::size_t>(first, w*64);
+		auto end = std::min<std::size_t>(last+1, (w+1)*64);
+		auto word = bitmap.words[w];
+		for (auto row = begin; row < end; ++row) {
+			auto bit = quint64(1) << (row%64);
+			auto unit = units[row-first];
+			if (!unit || !concurrent_filter || concurrent_filter(*unit))
+				word |= bit;
+			else
+				word &= ~bit;
+		}
+		bitmap.words[w] = word;
+	};
+	std::vector<std::size_t> words;
+	for (std::size_t w = first/64; w <= std::size_t(last)/64; ++w)
+		words.push_back(w);
+	if (words.size() == 1)
+		evaluate_word(words.front());
+	else
+		QtConcurrent::blockingMap(words, evaluate_word);
+	if (is_cancelled())
+		return false;
+	if (gui_filter) {
+		std::vector<int> rows;
+		std::vector<const Unit *> batch;
+		for (int row = first; row <= last; ++row) {
+			if (!bitmap.test(row))
+				continue;
+			if (auto unit = units[row-first]) {
+				rows.push_back(row);
+				batch.push_back(unit);
+			}
+		}
+		gui_filter(batch);
+		for (std::size_t i = 0; i < rows.size(); ++i)
+			if (!batch[i])
+				bitmap.set(rows[i], false);
+	}
+	return !is_cancelled();
+}
+
+bool UnitFilterProxyModel::evaluateUserFilters(bitmap_t &bitmap, int first,
+		std::span<const Unit *const> units,
+		const UserUnitFilters &filters,
+		const std::atomic<bool> *cancelled)
+{
+	return evaluate(bitmap, first, units,
+		[&filters](const Unit &unit) { return filters.concurrentFilters(unit); },
+		filters.hasGuiThreadFilters()
+			? UnitBatchFilter([&filters](std::span<const Unit *> units) { filters.guiThreadFilters(units); })
+			: UnitBatchFilter(),
+		cancelled);
+}
+
+std::vector<const Unit *> UnitFilterProxyModel::units(int first, int last) const
+{
+	std::vector<const Unit *> units;
+	for (int row = first; row <= last; ++row)
+		units.push_back(_units->get(row));
+	return units;
+}
+
+void UnitFilterProxyModel::evaluateBaseFilter(int first, int last)
+{
+	if (isConcurrentFilter(_base_filter))
+		evaluate(_base_accepted, first, units(first, last), _base_filter, {});
+	else
+		evaluate(_base_accepted, first, units(first, last), {}, [this](std::span<const Unit *> units) {
+			filterUnits(_base_filter, units);
+		});
+}
+
+void UnitFilterProxyModel::evaluateUserFilters(int first, int last)
+{
+	if (!_user_filters) {
+		evaluate(_user_accepted, first, units(first, last), {}, {});
+		return;
+	}
+	evaluateUserFilters(_user_accepted, first, units(first, last), *_user_filters);
+	_user_filters->reportFailures();
+}
+
+void UnitFilterProxyModel::combine(int first, int last)
+{
+	if (first > last)
+		return;
+	for (std::size_t w = first/64; w <= std::size_t(last)/64; ++w)
+		_accepted.words[w] = _base_accepted.words[w] & _user_accepted.words[w];
+}
+
+void UnitFilterProxyModel::evaluateRows(int first, int last)
+{
+	evaluateBaseFilter(first, last);
+	evaluateUserFilters(first, last);
+	combine(first, last);
+}
+
+void UnitFilterProxyModel::resetRows()
+{
+	int count = _units ? _units->rowCount() : 0;
+	for (auto bitmap: {&_base_accepted, &_user_accepted, &_accepted})
+		bitmap->resize(count);
+	// All rows are evaluated with the current filters
+	++_user_generation;
+	_user_pending = false;
+	evaluateRows(0, count-1);
+}
@@ -20,6 +20,8 @@
 #define UNIT_FILTER_PROXY_MODEL_H
 
 #include <QSortFilterProxyModel>
+#include <QFutureWatcher>
+#include <QThreadPool>
 
 #include "UserUnitFilters.h"
 
@@ -37,7 +39,7 @@ public:
 	void setBaseFilter(Filter &&filter)
 	{
 		_base_filter = UnitFilter(std::forward<Filter>(filter));
-		invalidateRowsFilter();
+		baseFilterChanged();
 	}
 
 	const std::shared_ptr<const UserUnitFilters> &userFilters() const { return _user_filters; }
@@ -57,6 +59,80 @@ private:
 	ObjectList<Unit> *_units;
 	UnitFilter _base_filter;
 	std::shared_ptr<const UserUnitFilters> _user_filters;
+	QList<QMetaObject::Connection> _source_connections;
+
+	// One bit per source row
+	struct bitmap_t
+	{
+		std::vector<quint64> words;
+		std::size_t size = 0;
+
+		bool test(std::size_t i) const {
+			return words[i/64] & (quint64(1) << (i%64));
+		}
+		void set(std::size_t i, bool value) {
+			if (value)
+				words[i/64] |= quint64(1) << (i%64);
+			else
+				words[i/64] &= ~(quint64(1) << (i%64));
+		}
+		void resize(std::size_t n);
+		void insert(std::size_t pos, std::size_t count);
+		void erase(std::size_t pos, std::size_t count);
+	};
+	// Filter results are kept separately so that changing the user
+	// filters does not run the base filter again (and vice versa),
+	// _accepted is the word-wise AND of both and is read by
+	// filterAcceptsRow.
+	bitmap_t _base_accepted, _user_accepted, _accepted;
+
+	// Changes to the user filters are evaluated in a background thread
+	// on a copy of the filters, only one evaluation is running at a time.
+	// A superseded evaluation is cancelled and started again when it
+	// returns. Its result is applied in one invalidation if nothing
+	// changed in the meantime (the generation is unchanged).
+	struct user_evaluation_t
+	{
+		std::shared_ptr<const UserUnitFilters> filters;
+		std::vector<const Unit *> units;
+		quint64 generation;
+		std::atomic<bool> cancelled = false;
+	};
+	std::shared_ptr<user_evaluation_t> _user_evaluation;
+	// Evaluations wait for the script chunks run in the global pool,
+	// they use their own pool so they cannot starve it.
+	QThreadPool _user_evaluation_pool;
+	QFutureWatcher<std::optional<bitmap_t>> _user_evaluation_watcher;
+	quint64 _user_generation = 0;
+	bool _user_pending = false; // _user_accepted is from older filters
+
+	void baseFilterChanged();
+	void userFiltersChanged();
+	void startUserEvaluation();
+	void userEvaluationFinished();
+	// Cancel and wait for the background evaluation before the units or
+	// the game data they read are modified (ObjectListBase::aboutToUpdate),
+	// its result will be discarded.
+	void cancelUserEvaluation();
+	// Evaluate concurrent_filter in the thread pool, then gui_filter in the
+	// calling thread in a single batch of the rows still accepted. units
+	// are the units from row first. Returns false if cancelled was set
+	// before it finished.
+	static bool evaluate(bitmap_t &bitmap, int first,
+			std::span<const Unit *const> units,
+			const UnitFilter &concurrent_filter,
+			const UnitBatchFilter &gui_filter,
+			const std::atomic<bool> *cancelled = nullptr);
+	static bool evaluateUserFilters(bitmap_t &bitmap, int first,
+			std::span<const Unit *const> units,
+			const UserUnitFilters &filters,
+			const std::atomic<bool> *cancelled = nullptr);
+	std::vector<const Unit *> units(int first, int last) const;
+	void evaluateBaseFilter(int first, int last);
+	void evaluateUserFilters(int first, int last);
+	void combine(int first, int last);
+	void evaluateRows(int first, int last);
+	void resetRows();
 };
 
 #endif
@@ -0,0 +1,168 @@
+/*
+ * Copyright 2024 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "UnitNameIndex.h"
+
+#include "ObjectList.h"
+#include "Unit.h"
+
+#include <algorithm>
+
+UnitNameIndex::UnitNameIndex(const ObjectList<Unit> &units, QObject *parent):
+	QObject(parent),
+	_units(units)
+{
+	connect(&units, &QAbstractItemModel::rowsInserted,
+		this, [this](const QModelIndex &, int first, int last) {
+			addRows(first, last);
+		});
+	connect(&units, &QAbstractItemModel::rowsAboutToBeRemoved,
+		this, [this](const QModelIndex &, int first, int last) {
+			removeRows(first, last);
+		});
+	connect(&units, &QAbstractItemModel::dataChanged,
+		this, [this](const QModelIndex &top_left, const QModelIndex &bottom_right) {
+			updateRows(top_left.row(), bottom_right.row());
+		});
+	connect(&units, &QAbstractItemModel::modelReset,
+		this, &UnitNameIndex::reset);
+	reset();
+}
+
+UnitNameIndex::~UnitNameIndex()
+{
+}
+
+std::optional<std::vector<const Unit *>> UnitNameIndex::candidates(const QString &key,
+		const std::vector<const Unit *> *previous) const
+{
+	auto grams = trigrams(key);
+	if (grams.empty())
+		return std::nullopt;
+	// Intersect smaller lists first
+	std::vector<const std::vector<const Unit *> *> lists;
+	for (auto gram: grams) {
+		auto it = _postings.find(gram);
+		if (it == _postings.end())
+			return std::vector<const Unit *>{};
+		lists.push_back(&it.value());
+	}
+	std::ranges::sort(lists, {}, [](const auto *list) { return list->size(); });
+	std::vector<const Unit *> result, tmp;
+	if (previous)
+		std::ranges::set_intersection(*previous, *lists.front(), back_inserter(result));
+	else
+		result = *lists.front();
+	for (auto list: lists | std::views::drop(1)) {
+		if (result.empty())
+			break;
+		tmp.clear();
+		std::ranges::set_intersection(result, *list, back_inserter(tmp));
+		swap(result, tmp);
+	}
+	return result;
+}
+
+std::vector<UnitNameIndex::trigram_t> UnitNameIndex::trigrams(const QString &key)
+{
+	std::vector<trigram_t> grams;
+	for (qsizetype i = 0; i+2 < key.size(); ++i)
+		grams.push_back(trigram_t(key[i].unicode()) << 32
+				| trigram_t(key[i+1].unicode()) << 16
+				| trigram_t(key[i+2].unicode()));
+	std::ranges::sort(grams);
+	auto [last, end] = std::ranges::unique(grams);
+	grams.erase(last, end);
+	return grams;
+}
+
+void UnitNameIndex::addUnit(const Unit *unit)
+{
+	auto grams = trigrams(unit->searchName());
+	for (auto gram: grams) {
+		auto &list = _postings[gram];
+		list.insert(std::ranges::lower_bound(list, unit), unit);
+	}
+	_unit_trigrams.insert_or_assign(unit, std::move(grams));
+}
+
+void UnitNameIndex::removeUnit(const Unit *unit)
+{
+	auto it = _unit_trigrams.find(unit);
+	if (it == _unit_trigrams.end())
+		return;
+	for (auto gram: it->second) {
+		auto list = _postings.find(gram);
+		Q_ASSERT(list != _postings.end());
+		auto [first, last] = std::ranges::equal_range(list.value(), unit);
+		list->erase(first, last);
+		if (list->empty())
+			_postings.erase(list);
+	}
+	_unit_trigrams.erase(it);
+}
+
+void UnitNameIndex::addRows(int first, int last)
+{
+	for (int row = first; row <= last; ++row)
+		if (auto unit = _units.get(row))
+			addUnit(unit);
+	++_generation;
+}
+
+void UnitNameIndex::removeRows(int first, int last)
+{
+	for (int row = first; row <= last; ++row)
+		removeUnit(_units.get(row));
+	++_generation;
+}
+
+void UnitNameIndex::updateRows(int first, int last)
+{
+	bool changed = false;
+	for (int row = first; row <= last; ++row) {
+		auto unit = _units.get(row);
+		if (!unit || !(unit->lastChanges() & Unit::NameChanged))
+			continue;
+		auto it = _unit_trigrams.find(unit);
+		if (it != _unit_trigrams.end() && it->second == trigrams(unit->searchName()))
+			continue;
+		removeUnit(unit);
+		addUnit(unit);
+		changed = true;
+	}
+	if (changed)
+		++_generation;
+}
+
+void UnitNameIndex::reset()
+{
+	_postings.clear();
+	_unit_trigrams.clear();
+	for (int row = 0; row < _units.rowCount(); ++row) {
+		auto unit = _units.get(row);
+		auto grams = trigrams(unit->searchName());
+		for (auto gram: grams)
+			_postings[gram].push_back(unit);
+		_unit_trigrams.emplace(unit, std::move(grams));
+	}
+	for (auto &list: _postings)
+		std::ranges::sort(list);
+	++_generation;
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2024 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef UNIT_NAME_INDEX_H
+#define UNIT_NAME_INDEX_H
+
+#include <QObject>
+#include <QHash>
+
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+class Unit;
+template <typename T>
+class ObjectList;
+
+// Inverted index of unit search names (Unit::searchName) by trigrams,
+// maintained from the unit list signals.
+class UnitNameIndex: public QObject
+{
+	Q_OBJECT
+public:
+	UnitNameIndex(const ObjectList<Unit> &units, QObject *parent = nullptr);
+	~UnitNameIndex() override;
+
+	// Incremented every time the index is modified
+	quint64 generation() const { return _generation; }
+
+	// Sorted units whose search name contains all the trigrams of key (it
+	// must already be converted with Unit::searchKey). Returns nullopt if
+	// key is too short for using the index. The search may be restricted
+	// to a sorted list of units from a previous query (when key starts with
+	// the previous key).
+	std::optional<std::vector<const Unit *>> candidates(const QString &key,
+			const std::vector<const Unit *> *previous = nullptr) const;
+
+private:
+	using trigram_t = quint64;
+	static std::vector<trigram_t> trigrams(const QString &key);
+
+	void addUnit(const Unit *unit);
+	void removeUnit(const Unit *unit);
+	void addRows(int first, int last);
+	void removeRows(int first, int last);
+	void updateRows(int first, int last);
+	void reset();
+
+	const ObjectList<Unit> &_units;
+	quint64 _generation = 1;
+	QHash<trigram_t, std::vector<const Unit *>> _postings; // sorted units
+	std::unordered_map<const Unit *, std::vector<trigram_t>> _unit_trigrams;
+};
+
+#endif
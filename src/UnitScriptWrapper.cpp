@@ -18,9 +18,13 @@
 
 #include "UnitScriptWrapper.h"
 
+#include "DwarfFortressData.h"
+#include "ObjectList.h"
 #include "Unit.h"
 #include "df/utils.h"
 
+#include <QJSEngine>
+
 UnitScriptWrapper::UnitScriptWrapper()
 {
 }
@@ -34,6 +38,14 @@ UnitScriptWrapper::~UnitScriptWrapper()
 {
 }
 
+void UnitScriptWrapper::setUnit(const Unit *unit)
+{
+	if (unit)
+		_unit = unit->shared_from_this();
+	else
+		_unit.reset();
+}
+
 #define MAKE_WRAPPER_METHOD(type, name) \
 type UnitScriptWrapper::name() const \
 { \
@@ -57,21 +69,47 @@ MAKE_WRAPPER_METHOD(bool, isChild)
 MAKE_WRAPPER_METHOD(bool, isAdult)
 MAKE_WRAPPER_METHOD(bool, hasMenialWorkExemption)
 
+int UnitScriptWrapper::id() const
+{
+	if (!_unit)
+		return -1;
+	return (*_unit)->id;
+}
+
+int UnitScriptWrapper::index() const
+{
+	if (!_unit)
+		return -1;
+	// Table columns use the same rows as the unit list
+	auto index = _unit->data().units->find(*_unit);
+	return index.isValid() ? index.row() : -1;
+}
+
 QString UnitScriptWrapper::raceName() const
 {
 	if (!_unit)
 		return {};
-	if (auto creature = _unit->creature_raw())
-		return df::fromCP437(creature->name[0]);
-	else
-		return {};
+	return raceName(*_unit);
 }
 
 QString UnitScriptWrapper::casteName() const
 {
 	if (!_unit)
 		return {};
-	if (auto caste = _unit->caste_raw())
+	return casteName(*_unit);
+}
+
+QString UnitScriptWrapper::raceName(const Unit &unit)
+{
+	if (auto creature = unit.creature_raw())
+		return df::fromCP437(creature->name[0]);
+	else
+		return {};
+}
+
+QString UnitScriptWrapper::casteName(const Unit &unit)
+{
+	if (auto caste = unit.caste_raw())
 		return df::fromCP437(caste->caste_name[0]);
 	else
 		return {};
@@ -85,3 +123,80 @@ df::profession_t UnitScriptWrapper::profession() const
 		return (*_unit)->profession;
 }
 
+
+UnitTableScriptWrapper::UnitTableScriptWrapper()
+{
+}
+
+UnitTableScriptWrapper::~UnitTableScriptWrapper()
+{
+}
+
+void UnitTableScriptWrapper::setTable(const UnitTable *table)
+{
+	_table = table;
+}
+
+int UnitTableScriptWrapper::count() const
+{
+	if (!_table)
+		return 0;
+	return _table->count();
+}
+
+QJSValue UnitTableScriptWrapper::ids() const
+{
+	return array("Int32Array", UnitTable::Column::Ids);
+}
+
+QJSValue UnitTableScriptWrapper::race() const
+{
+	return array("Int32Array", UnitTable::Column::Races);
+}
+
+QJSValue UnitTableScriptWrapper::flags() const
+{
+	return array("Uint32Array", UnitTable::Column::Flags);
+}
+
+QJSValue UnitTableScriptWrapper::skillRating(int skill) const
+{
+	if (skill < 0 || skill >= df::job_skill::Count)
+		return {};
+	return array("Int8Array", UnitTable::Column::SkillRating, skill);
+}
+
+QJSValue UnitTableScriptWrapper::physicalAttribute(int attr) const
+{
+	if (attr < 0 || attr >= df::physical_attribute_type::Count)
+		return {};
+	return array("Int32Array", UnitTable::Column::PhysicalAttribute, attr);
+}
+
+QJSValue UnitTableScriptWrapper::mentalAttribute(int attr) const
+{
+	if (attr < 0 || attr >= df::mental_attribute_type::Count)
+		return {};
+	return array("Int32Array", UnitTable::Column::MentalAttribute, attr);
+}
+
+QJSValue UnitTableScriptWrapper::array(const char *type, UnitTable::Column column, int index) const
+{
+	auto engine = qjsEngine(this);
+	Q_ASSERT(engine);
+	auto generation = _table ? _table->generation() : 0;
+	if (_table != _cached_table || generation != _cached_generation) {
+		_arrays.clear();
+		_cached_table = _table;
+		_cached_generation = generation;
+	}
+	auto key = std::make_pair(static_cast<int>(column), index);
+	if (auto it = _arrays.find(key); it != _arrays.end())
+		return *it;
+	// QByteArray is converted to an ArrayBuffer, wrap it in a view of the
+	// column type.
+	auto data = _table ? _table->column(column, index) : QByteArray();
+	auto array = engine->globalObject().property(type).callAsConstructor({engine->toScriptValue(data)});
+	_arrays.insert(key, array);
+	return array;
+}
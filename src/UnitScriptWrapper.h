@@ -20,30 +20,49 @@
 #define UNIT_SCRIPT_WRAPPER_H
 
 #include <QObject>
+#include <QJSValue>
+#include <QHash>
+
+#include <memory>
 
 #include "df_enums.h"
+#include "UnitTable.h"
 
 class Unit;
+class UnitTable;
 
 class UnitScriptWrapper: public QObject
 {
 	Q_OBJECT
+	Q_PROPERTY(int id READ id)
+	Q_PROPERTY(int index READ index)
 	Q_PROPERTY(QString name READ displayName)
 	Q_PROPERTY(QString race_name READ raceName)
 	Q_PROPERTY(QString caste_name READ casteName)
 	Q_PROPERTY(df::profession_t profession READ profession)
 
+	Q_CLASSINFO("doc:id", "Unit id")
+	Q_CLASSINFO("doc:index", "Index of this unit in the units arrays")
 	Q_CLASSINFO("doc:isFortControlled", "This unit is controlled by the player")
 public:
 	UnitScriptWrapper(); // test dummy constructor
 	UnitScriptWrapper(const Unit &unit);
 	~UnitScriptWrapper() override;
 
+	// Retarget the wrapper (may be nullptr for releasing the unit)
+	void setUnit(const Unit *unit);
+
+	int id() const;
+	int index() const;
 	QString displayName() const;
 	QString raceName() const;
 	QString casteName() const;
 	df::profession_t profession() const;
 
+	// Also used by UnitFilterCompiler
+	static QString raceName(const Unit &unit);
+	static QString casteName(const Unit &unit);
+
 	Q_INVOKABLE bool isFortControlled() const;
 	Q_INVOKABLE bool isCrazed() const;
 	Q_INVOKABLE bool isOpposedToLife() const;
@@ -61,4 +80,57 @@ private:
 	std::shared_ptr<const Unit> _unit;
 };
 
+// The "units" script global: unit data as typed arrays indexed the same way
+// for all units (see the unit index property), for computing statistics
+// without wrapping each unit. Arrays are shared by all calls in the engine
+// until the units change, scripts must not modify them.
+class UnitTableScriptWrapper: public QObject
+{
+	Q_OBJECT
+	Q_PROPERTY(int count READ count)
+	Q_PROPERTY(QJSValue ids READ ids)
+	Q_PROPERTY(QJSValue race READ race)
+	Q_PROPERTY(QJSValue flags READ flags)
+
+	Q_CLASSINFO("doc:count", "Number of units")
+	Q_CLASSINFO("type:ids", "Int32Array")
+	Q_CLASSINFO("doc:ids", "Unit ids")
+	Q_CLASSINFO("type:race", "Int32Array")
+	Q_CLASSINFO("doc:race", "Creature raw indices")
+	Q_CLASSINFO("type:flags", "Uint32Array")
+	Q_CLASSINFO("doc:flags", "Flags as unit_flag bits")
+	Q_CLASSINFO("type:skillRating", "Int8Array")
+	Q_CLASSINFO("doc:skillRating", "Skill ratings (-1 without the skill)")
+	Q_CLASSINFO("type:physicalAttribute", "Int32Array")
+	Q_CLASSINFO("doc:physicalAttribute", "Physical attribute values")
+	Q_CLASSINFO("type:mentalAttribute", "Int32Array")
+	Q_CLASSINFO("doc:mentalAttribute", "Mental attribute values")
+public:
+	UnitTableScriptWrapper();
+	~UnitTableScriptWrapper() override;
+
+	// Retarget the wrapper (may be nullptr for an empty table)
+	void setTable(const UnitTable *table);
+
+	int count() const;
+	QJSValue ids() const;
+	QJSValue race() const;
+	QJSValue flags() const;
+
+	// Arguments are values from the job_skill, physical_attribute_type or
+	// mental_attribute_type globals, invalid values return undefined.
+	Q_INVOKABLE QJSValue skillRating(int skill) const;
+	Q_INVOKABLE QJSValue physicalAttribute(int attr) const;
+	Q_INVOKABLE QJSValue mentalAttribute(int attr) const;
+
+private:
+	QJSValue array(const char *type, UnitTable::Column column, int index = 0) const;
+
+	const UnitTable *_table = nullptr;
+	// Arrays created from the current generation of _cached_table
+	mutable const UnitTable *_cached_table = nullptr;
+	mutable quint64 _cached_generation = 0;
+	mutable QHash<std::pair<int, int>, QJSValue> _arrays; // column, index
+};
+
 #endif
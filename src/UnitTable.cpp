@@ -0,0 +1,151 @@
+/*
+ * Copyright 2024 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "UnitTable.h"
+
+#include "DwarfFortressData.h"
+#include "ObjectList.h"
+#include "Unit.h"
+
+#include <QMetaEnum>
+
+static constexpr std::size_t ColumnCount = 3
+	+ df::job_skill::Count
+	+ df::physical_attribute_type::Count
+	+ df::mental_attribute_type::Count;
+
+// Generations are unique among all tables
+static std::atomic<quint64> NextGeneration = 0;
+
+UnitTable::UnitTable(const ObjectList<Unit> &units, QObject *parent):
+	QObject(parent),
+	_units(units),
+	_generation(++NextGeneration),
+	_columns(ColumnCount)
+{
+	connect(&units, &QAbstractItemModel::rowsInserted,
+		this, &UnitTable::invalidate);
+	connect(&units, &QAbstractItemModel::rowsRemoved,
+		this, &UnitTable::invalidate);
+	connect(&units, &QAbstractItemModel::dataChanged,
+		this, &UnitTable::invalidate);
+	connect(&units, &QAbstractItemModel::modelReset,
+		this, &UnitTable::invalidate);
+}
+
+UnitTable::~UnitTable()
+{
+}
+
+template <typename T, typename F>
+static QByteArray buildColumn(const ObjectList<Unit> &units, F &&get)
+{
+	QByteArray column(units.rowCount() * sizeof(T), Qt::Uninitialized);
+	auto data = reinterpret_cast<T *>(column.data());
+	for (int row = 0; row < units.rowCount(); ++row)
+		data[row] = get(*units.get(row));
+	return column;
+}
+
+QByteArray UnitTable::column(Column column, int index) const
+{
+	auto i = slot(column, index);
+	if (!i)
+		return {};
+	QMutexLocker lock(&_mutex);
+	auto &data = _columns[*i];
+	if (!data)
+		data = makeColumn(column, index);
+	return *data;
+}
+
+int UnitTable::count() const
+{
+	return _units.rowCount();
+}
+
+std::optional<std::size_t> UnitTable::slot(Column column, int index)
+{
+	auto array_slot = [index](std::size_t offset, int count) -> std::optional<std::size_t> {
+		if (index < 0 || index >= count)
+			return std::nullopt;
+		return offset + index;
+	};
+	constexpr std::size_t physical_offset = 3 + df::job_skill::Count;
+	constexpr std::size_t mental_offset = physical_offset + df::physical_attribute_type::Count;
+	switch (column) {
+	case Column::Ids:
+		return 0;
+	case Column::Races:
+		return 1;
+	case Column::Flags:
+		return 2;
+	case Column::SkillRating:
+		return array_slot(3, df::job_skill::Count);
+	case Column::PhysicalAttribute:
+		return array_slot(physical_offset, df::physical_attribute_type::Count);
+	case Column::MentalAttribute:
+		return array_slot(mental_offset, df::mental_attribute_type::Count);
+	}
+	return std::nullopt;
+}
+
+QByteArray UnitTable::makeColumn(Column column, int index) const
+{
+	switch (column) {
+	case Column::Ids:
+		return buildColumn<qint32>(_units, [](const Unit &unit) {
+			return unit->id;
+		});
+	case Column::Races:
+		return buildColumn<qint32>(_units, [](const Unit &unit) {
+			return unit->race;
+		});
+	case Column::Flags:
+		return buildColumn<quint32>(_units, [](const Unit &unit) {
+			auto meta = QMetaEnum::fromType<Unit::Flag>();
+			quint32 flags = 0;
+			for (int i = 0; i < meta.keyCount(); ++i)
+				if (unit.hasFlag(static_cast<Unit::Flag>(meta.value(i))))
+					flags |= 1u << meta.value(i);
+			return flags;
+		});
+	case Column::SkillRating:
+		return buildColumn<qint8>(_units, [skill = static_cast<df::job_skill_t>(index)](const Unit &unit) {
+			return unit.data().skills.rating(unit.skillRow(), skill);
+		});
+	case Column::PhysicalAttribute:
+		return buildColumn<qint32>(_units, [attr = static_cast<df::physical_attribute_type_t>(index)](const Unit &unit) {
+			return unit.attributeValue(attr);
+		});
+	case Column::MentalAttribute:
+		return buildColumn<qint32>(_units, [attr = static_cast<df::mental_attribute_type_t>(index)](const Unit &unit) {
+			return unit.attributeValue(attr);
+		});
+	}
+	return {};
+}
+
+void UnitTable::invalidate()
+{
+	QMutexLocker lock(&_mutex);
+	for (auto &column: _columns)
+		column.reset();
+	_generation.store(++NextGeneration, std::memory_order_release);
+}
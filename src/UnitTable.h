@@ -0,0 +1,75 @@
+/*
+ * Copyright 2024 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef UNIT_TABLE_H
+#define UNIT_TABLE_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QMutex>
+
+#include <atomic>
+#include <optional>
+#include <vector>
+
+#include "df_enums.h"
+
+class Unit;
+template <typename T>
+class ObjectList;
+
+// Columnar copy of the unit list for scripts (see UnitTableScriptWrapper),
+// each column is built the first time it is used after the list changed.
+class UnitTable: public QObject
+{
+	Q_OBJECT
+public:
+	UnitTable(const ObjectList<Unit> &units, QObject *parent = nullptr);
+	~UnitTable() override;
+
+	// Each column is an array of native integers in unit row order.
+	enum class Column
+	{
+		Ids, // int32
+		Races, // int32
+		Flags, // uint32, bit n is set for Unit::Flag n
+		SkillRating, // int8 for each job_skill, -1 without the skill
+		PhysicalAttribute, // int32 for each physical_attribute_type
+		MentalAttribute, // int32 for each mental_attribute_type
+	};
+	// index is the skill or attribute, returns a null array if it is
+	// invalid. May be called from any thread, but like units themselves,
+	// not while the list is being updated.
+	QByteArray column(Column column, int index = 0) const;
+	int count() const;
+	// Changes each time the list changes, never reused by another table
+	quint64 generation() const { return _generation.load(std::memory_order_acquire); }
+
+private:
+	void invalidate();
+	static std::optional<std::size_t> slot(Column column, int index);
+	QByteArray makeColumn(Column column, int index) const;
+
+	const ObjectList<Unit> &_units;
+	std::atomic<quint64> _generation;
+	mutable QMutex _mutex;
+	mutable std::vector<std::optional<QByteArray>> _columns;
+};
+
+#endif
@@ -21,22 +21,54 @@
 #include "Application.h"
 #include "ScriptManager.h"
 #include "Unit.h"
-#include "UnitScriptWrapper.h"
-#include "LogCategory.h"
+#include "UnitNameIndex.h"
+#include "DwarfFortressData.h"
 
 UnitNameFilter::UnitNameFilter(const QString &text):
-	_text(removeMarks(text))
+	_text(Unit::searchKey(text)),
+	_candidates(std::make_shared<candidates_t>())
 {
 }
 
+UnitNameFilter::UnitNameFilter(const QString &text, const UnitNameFilter &previous):
+	_text(Unit::searchKey(text)),
+	_candidates(std::make_shared<candidates_t>()),
+	_previous(previous._candidates)
+{
+	Q_ASSERT(_text.startsWith(previous._text));
+}
+
 bool UnitNameFilter::operator()(const Unit &unit) const
 {
-	return removeMarks(unit.displayName()).contains(_text, Qt::CaseInsensitive);
+	const auto &units = candidates(*unit.data().unit_names);
+	if (units && !std::ranges::binary_search(*units, &unit))
+		return false;
+	return unit.searchName().contains(_text);
 }
 
-QString UnitNameFilter::removeMarks(const QString &text)
+const std::optional<std::vector<const Unit *>> &UnitNameFilter::candidates(const UnitNameIndex &index) const
 {
-	return text.normalized(QString::NormalizationForm_KD).remove(QRegularExpression("\\p{M}"));
+	auto &c = *_candidates;
+	auto up_to_date = [&]() {
+		return c.index.load(std::memory_order_acquire) == &index
+			&& c.generation.load(std::memory_order_acquire) == index.generation();
+	};
+	if (!up_to_date()) {
+		QMutexLocker lock(&c.mutex);
+		if (!up_to_date()) {
+			// Previous results can only be reused if they were computed
+			// from the same index state.
+			const std::vector<const Unit *> *previous = nullptr;
+			if (_previous && _previous->index == &index
+					&& _previous->generation == index.generation()
+					&& _previous->units)
+				previous = &*_previous->units;
+			c.units = index.candidates(_text, previous);
+			c.generation.store(index.generation(), std::memory_order_release);
+			c.index.store(&index, std::memory_order_release);
+		}
+	}
+	return c.units;
 }
 
 bool UnitNameRegexFilter::operator()(const Unit &unit) const
@@ -46,12 +78,22 @@ bool UnitNameRegexFilter::operator()(const Unit &unit) const
 
 bool ScriptedUnitFilter::operator()(const Unit &unit) const
 {
-	auto result = script.call({Application::scripts().makeUnit(unit)});
-	if (result.isError()) {
-		qCCritical(ScriptLog) << "Filter script failed:" << result.property("message").toString();
+	if (failed())
+		return false;
+	auto result = Application::scripts().filterUnit(script, unit);
+	if (!result) {
+		state->failed = true;
 		return false;
 	}
-	return result.toBool();
+	return *result;
+}
+
+void ScriptedUnitFilter::operator()(std::span<const Unit *> units) const
+{
+	if (failed() || !Application::scripts().filterUnits(source, units)) {
+		state->failed = true;
+		std::ranges::fill(units, nullptr);
+	}
 }
 
 const std::vector<std::pair<const char *, UnitFilter>> BuiltinUnitFilters = {
@@ -61,6 +103,23 @@ const std::vector<std::pair<const char *, UnitFilter>> BuiltinUnitFilters = {
 	{QT_TRANSLATE_NOOP("BuiltinUnitFilters", "Pets or Livestock"), [](const Unit &unit) { return unit.category() == Unit::Category::PetsOrLivestock; }},
 };
 
+bool isConcurrentFilter(const UnitFilter &filter)
+{
+	return !filter.target<ScriptedUnitFilter>();
+}
+
+void filterUnits(const UnitFilter &filter, std::span<const Unit *> units)
+{
+	if (!filter)
+		return;
+	if (auto script = filter.target<ScriptedUnitFilter>())
+		(*script)(units);
+	else
+		for (auto &unit: units)
+			if (unit && !filter(*unit))
+				unit = nullptr;
+}
+
 UserUnitFilters::UserUnitFilters(QObject *parent):
 	QAbstractListModel(parent),
 	_temporary_type(TemporaryType::Simple),
@@ -107,6 +166,9 @@ bool UserUnitFilters::removeRows(int row, int count, const QModelIndex &parent)
 
 void UserUnitFilters::addFilter(const QString &name, UnitFilter filter)
 {
+	// Adding a script filter again gives it another try
+	if (auto script = filter.target<ScriptedUnitFilter>())
+		script->reset();
 	beginInsertRows({}, _filters.size(), _filters.size());
 	_filters.emplace_back(name, std::move(filter));
 	endInsertRows();
@@ -123,6 +185,9 @@ void UserUnitFilters::clear()
 
 QString UserUnitFilters::setTemporaryFilter(TemporaryType type, const QString &text)
 {
+	auto previous_filter = _temporary_type == TemporaryType::Simple
+		? _temporary_filter.target<UnitNameFilter>()
+		: nullptr;
 	_temporary_type = type;
 	_temporary_text = text;
 	if (text.isEmpty())
@@ -130,7 +195,11 @@ QString UserUnitFilters::setTemporaryFilter(TemporaryType type, const QString &t
 	else {
 		switch (type) {
 		case TemporaryType::Simple:
-			_temporary_filter = UnitNameFilter{text};
+			// Appending characters only narrows the previous search
+			if (previous_filter && Unit::searchKey(text).startsWith(previous_filter->text()))
+				_temporary_filter = UnitNameFilter{text, *previous_filter};
+			else
+				_temporary_filter = UnitNameFilter{text};
 			break;
 		case TemporaryType::Regex:
 			{
@@ -142,10 +211,11 @@ QString UserUnitFilters::setTemporaryFilter(TemporaryType type, const QString &t
 			break;
 		case TemporaryType::Script:
 			{
-				auto filter = Application::scripts().makeScript(text);
-				if (filter.isError())
-					return filter.property("message").toString();
-				_temporary_filter = ScriptedUnitFilter{std::move(filter)};
+				QString error;
+				auto filter = Application::scripts().makeFilter(text, &error);
+				if (!filter)
+					return error;
+				_temporary_filter = std::move(filter);
 			}
 			break;
 		}
@@ -155,9 +225,52 @@ QString UserUnitFilters::setTemporaryFilter(TemporaryType type, const QString &t
 }
 
 bool UserUnitFilters::operator()(const Unit &unit) const
+{
+	for (const auto &[name, filter]: _filters) {
+		if (filter && !filter(unit)) {
+			reportFailure(name, filter);
+			return false;
+		}
+	}
+	if (_temporary_filter && !_temporary_filter(unit)) {
+		reportFailure({}, _temporary_filter);
+		return false;
+	}
+	return true;
+}
+
+bool UserUnitFilters::concurrentFilters(const Unit &unit) const
 {
 	for (const auto &[name, filter]: _filters)
-		if (filter && !filter(unit))
+		if (filter && isConcurrentFilter(filter) && !filter(unit))
 			return false;
-	return !_temporary_filter || _temporary_filter(unit);
+	return !_temporary_filter || !isConcurrentFilter(_temporary_filter) || _temporary_filter(unit);
+}
+
+void UserUnitFilters::guiThreadFilters(std::span<const Unit *> units) const
+{
+	for (const auto &[name, filter]: _filters)
+		if (filter && !isConcurrentFilter(filter))
+			filterUnits(filter, units);
+	if (_temporary_filter && !isConcurrentFilter(_temporary_filter))
+		filterUnits(_temporary_filter, units);
+}
+
+bool UserUnitFilters::hasGuiThreadFilters() const
+{
+	return std::ranges::any_of(_filters, [](const auto &p) { return p.second && !isConcurrentFilter(p.second); })
+		|| (_temporary_filter && !isConcurrentFilter(_temporary_filter));
+}
+
+void UserUnitFilters::reportFailures() const
+{
+	for (const auto &[name, filter]: _filters)
+		reportFailure(name, filter);
+	reportFailure({}, _temporary_filter);
+}
+
+void UserUnitFilters::reportFailure(const QString &name, const UnitFilter &filter) const
+{
+	if (auto script = filter.target<ScriptedUnitFilter>(); script && script->takeFailure())
+		filterFailed(name, ScriptManager::timeBudgetMessage());
 }
@@ -22,25 +22,51 @@
 #include <QAbstractListModel>
 #include <QRegularExpression>
 #include <QJSValue>
+#include <QMutex>
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <span>
 
 class Unit;
+class UnitNameIndex;
 
 using UnitFilter = std::function<bool(const Unit &)>;
+// Filter a batch of units by replacing rejected units with nullptr
+using UnitBatchFilter = std::function<void(std::span<const Unit *>)>;
 
 struct AllUnits
 {
 	bool operator()(const Unit &) const noexcept { return true; }
 };
 
+// Units are first looked up in the UnitNameIndex, only candidates from the
+// index are compared with the text.
 class UnitNameFilter
 {
 public:
 	UnitNameFilter (const QString &text);
+	// Refine the candidates from previous, its text must be a prefix of text
+	UnitNameFilter (const QString &text, const UnitNameFilter &previous);
 	bool operator()(const Unit &) const;
 
+	const QString &text() const { return _text; }
+
 private:
-	static QString removeMarks(const QString &);
-	QString _text;
+	QString _text; // converted with Unit::searchKey
+	// Candidates are resolved when the filter is first called and again
+	// when the index changes, the filter may be called from several threads.
+	struct candidates_t
+	{
+		QMutex mutex;
+		std::atomic<const UnitNameIndex *> index = nullptr;
+		std::atomic<quint64> generation = 0;
+		std::optional<std::vector<const Unit *>> units;
+	};
+	std::shared_ptr<candidates_t> _candidates, _previous;
+
+	const std::optional<std::vector<const Unit *>> &candidates(const UnitNameIndex &index) const;
 };
 
 struct UnitNameRegexFilter
@@ -51,12 +77,38 @@ struct UnitNameRegexFilter
 
 struct ScriptedUnitFilter
 {
-	QJSValue script;
+	QJSValue script; // compiled in the GUI thread engine
+	QString source; // compiled again by worker thread engines
 	bool operator()(const Unit &) const;
+	// Evaluate the script in parallel with worker thread engines
+	void operator()(std::span<const Unit *> units) const;
+
+	// A script exceeding its time budget is disabled: it rejects all
+	// units without being evaluated again. The state is shared by copies
+	// of the filter.
+	struct state_t
+	{
+		std::atomic<bool> failed = false;
+		std::atomic<bool> reported = false;
+	};
+	std::shared_ptr<state_t> state = std::make_shared<state_t>();
+
+	bool failed() const { return state->failed; }
+	// True only for the first call after the filter failed
+	bool takeFailure() const { return state->failed && !state->reported.exchange(true); }
+	// Enable the filter again
+	void reset() { state = std::make_shared<state_t>(); }
 };
 
 extern const std::vector<std::pair<const char *, UnitFilter>> BuiltinUnitFilters;
 
+// Scripted filters are dispatched in batches (the calling thread blocks
+// while worker engines run them), other filters may be run concurrently.
+bool isConcurrentFilter(const UnitFilter &filter);
+// Apply filter to non-null units in batch, using the batch version from
+// ScriptedUnitFilter when possible.
+void filterUnits(const UnitFilter &filter, std::span<const Unit *> units);
+
 class UserUnitFilters: public QAbstractListModel
 {
 	Q_OBJECT
@@ -85,11 +137,25 @@ public:
 	QString setTemporaryFilter(TemporaryType type, const QString &text);
 
 	bool operator()(const Unit &) const;
+	// Only check filters where isConcurrentFilter is true (or false)
+	bool concurrentFilters(const Unit &) const;
+	// Failures are not reported, as the filters may be a copy evaluated
+	// in another thread, call reportFailures afterwards.
+	void guiThreadFilters(std::span<const Unit *> units) const;
+	bool hasGuiThreadFilters() const;
+	// Emit filterFailed for scripted filters that failed since last report,
+	// the failure state is shared with copies of the filters.
+	void reportFailures() const;
 
 signals:
 	void invalidated();
+	// A scripted filter exceeded its time budget and was disabled, name is
+	// empty for the temporary filter.
+	void filterFailed(const QString &name, const QString &error) const;
 
 private:
+	void reportFailure(const QString &name, const UnitFilter &filter) const;
+
 	std::vector<std::pair<QString, UnitFilter>> _filters;
 	UnitFilter _temporary_filter;
 	TemporaryType _temporary_type;
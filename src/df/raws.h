@@ -137,6 +137,8 @@ struct language_name
 	std::array<int16_t, 7> parts_of_speech;
 	int32_t language;
 
+	bool operator==(const language_name &) const = default;
+
 	using reader_type = StructureReader<language_name, "language_name",
 		Field<&language_name::first_name, "first_name">,
 		Field<&language_name::nickname, "nickname">,
@@ -48,6 +48,8 @@ struct unit_attribute
 	int max_value;
 	int soft_demotion;
 
+	bool operator==(const unit_attribute &) const = default;
+
 	using reader_type = StructureReader<unit_attribute, "unit_attribute",
 		Field<&unit_attribute::value, "value">,
 		Field<&unit_attribute::max_value, "max_value">,
@@ -126,6 +128,8 @@ struct curse_attr_change
 	std::array<int, mental_attribute_type::Count> mental_att_perc;
 	std::array<int, mental_attribute_type::Count> mental_att_add;
 
+	bool operator==(const curse_attr_change &) const = default;
+
 	using reader_type = StructureReader<curse_attr_change, "curse_attr_change",
 		Field<&curse_attr_change::physical_att_perc, "phys_att_perc">,
 		Field<&curse_attr_change::physical_att_add, "phys_att_add">,
@@ -0,0 +1,603 @@
+/*
+ * Copyright 2024 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+// Minimal DFHack remote server serving the functions used by workdetailtest
+// from a local DF process. It allows testing and benchmarking the DFHack
+// fallback path (see UnitLoadingBenchmark.cpp) without DFHack or the
+// plugins. Only one method is implemented per message, edits are not
+// supported.
+//
+// GetProcessInfo always returns pid 0 so that clients do not find the
+// native process and use DFHack for memory access.
+//
+// MapSharedMemory/ReadRawVShared are only available on POSIX systems, use
+// --no-shared-memory to test the socket transport.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+#include <dfs/Structures.h>
+#include <dfs/Reader.h>
+#ifdef Q_OS_WIN
+#include <dfs/Win32Process.h>
+#else
+#include <dfs/LinuxProcess.h>
+#include <dfs/WineProcess.h>
+#endif
+
+#include "CoreProtocol.pb.h"
+#include "llmemreader.pb.h"
+#include "workdetailtest.pb.h"
+
+#include "DwarfFortressReader.h"
+#include "df/types.h"
+
+#ifdef Q_OS_UNIX
+extern "C" {
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+}
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <functional>
+#include <ranges>
+
+// DFHack remote protocol, see RemoteClient.h in DFHack
+static constexpr std::string_view RequestMagic = "DFHack?\n";
+static constexpr std::string_view ResponseMagic = "DFHack!\n";
+static constexpr int32_t ProtocolVersion = 1;
+
+struct RPCMessageHeader
+{
+	int16_t id;
+	int16_t padding;
+	int32_t size;
+};
+static_assert(sizeof(RPCMessageHeader) == 8);
+
+enum : int16_t {
+	RPC_REPLY_RESULT = -1,
+	RPC_REPLY_FAIL = -2,
+	RPC_REPLY_TEXT = -3,
+	RPC_REQUEST_QUIT = -4,
+	RPC_BIND_METHOD = 0,
+	RPC_RUN_COMMAND = 1,
+};
+
+enum : int32_t {
+	CR_NOT_IMPLEMENTED = -1,
+	CR_OK = 0,
+	CR_FAILURE = 1,
+	CR_WRONG_USAGE = 2,
+	CR_NOT_FOUND = 3,
+};
+
+// Bound method ids start after the builtin ones
+static constexpr int16_t FirstMethodId = 16;
+
+// Refuse reads larger than this
+static constexpr std::size_t MaxReadLength = 64*1024*1024;
+
+static cppcoro::task<> readv(dfs::Process &process,
+		std::span<const dfs::MemoryBufferRef> buffers,
+		std::error_code &err)
+{
+	err = co_await process.readv(buffers);
+}
+
+class MockServer
+{
+public:
+	MockServer(dfs::Process &process, const dfs::ReaderFactory &factory, std::chrono::milliseconds latency, bool shared_memory);
+	~MockServer();
+
+	bool listen(quint16 port);
+
+private:
+	struct method_t
+	{
+		std::string plugin, name;
+		std::string input, output;
+		std::function<int32_t(std::string_view, std::string &)> call;
+	};
+	template <typename In, typename Out, typename F>
+	void addMethod(std::string plugin, std::string name, F &&f);
+
+	struct connection_t
+	{
+		QByteArray buffer;
+		bool handshake_done = false;
+		int suspend_count = 0;
+	};
+	void onNewConnection();
+	// Returns false if the connection must be closed
+	bool processMessages(QTcpSocket *socket, connection_t &connection);
+	int32_t bindMethod(const dfproto::CoreBindRequest &request, dfproto::CoreBindReply &reply);
+	void send(QTcpSocket *socket, QByteArray data);
+	void sendResult(QTcpSocket *socket, int32_t cr, const std::string &data);
+
+	std::error_code read(std::span<const dfs::MemoryBufferRef> buffers);
+	// Fill data from buffers, adding a result for each buffer to out
+	void readList(std::span<const dfs::MemoryBufferRef> buffers,
+			dfproto::llmemoryreader::ReadRawVOut &out,
+			bool copy_data);
+	std::error_code mapSharedMemory(const std::string &name);
+	void unmapSharedMemory();
+	// Reload raws if the world changed, returns the current world
+	uintptr_t prepare(DwarfFortressReader &reader);
+
+	QTcpServer _server;
+	dfs::Process &_process;
+	const dfs::ReaderFactory &_factory;
+	std::chrono::milliseconds _latency;
+	std::vector<method_t> _methods;
+	int _suspend_count;
+	uintptr_t _world;
+	dfs::ReadSession::shared_objects_cache_t _raws_cache;
+	std::unique_ptr<df::world_raws> _raws;
+	connection_t *_current_connection;
+	std::span<uint8_t> _shared_memory;
+};
+
+template <typename In, typename Out, typename F>
+void MockServer::addMethod(std::string plugin, std::string name, F &&f)
+{
+	_methods.push_back({
+		std::move(plugin), std::move(name),
+		std::string(In::descriptor()->full_name()),
+		std::string(Out::descriptor()->full_name()),
+		[f = std::forward<F>(f)](std::string_view data, std::string &out) -> int32_t {
+			In in;
+			Out result;
+			if (!in.ParseFromArray(data.data(), data.size()))
+				return CR_WRONG_USAGE;
+			try {
+				auto cr = f(in, result);
+				if (cr == CR_OK)
+					result.SerializeToString(&out);
+				return cr;
+			}
+			catch (std::exception &e) {
+				qWarning() << "Call failed:" << e.what();
+				return CR_FAILURE;
+			}
+		}
+	});
+}
+
+MockServer::MockServer(dfs::Process &process, const dfs::ReaderFactory &factory, std::chrono::milliseconds latency, bool shared_memory):
+	_process(process),
+	_factory(factory),
+	_latency(latency),
+	_suspend_count(0),
+	_world(0),
+	_current_connection(nullptr)
+{
+	using namespace dfproto;
+	QObject::connect(&_server, &QTcpServer::newConnection, [this]() { onNewConnection(); });
+
+	// Core
+	addMethod<EmptyMessage, StringMessage>({}, "GetVersion", [](auto &, auto &out) {
+		out.set_value("mock");
+		return CR_OK;
+	});
+	addMethod<EmptyMessage, StringMessage>({}, "GetDFVersion", [](auto &, auto &out) {
+		out.set_value("mock");
+		return CR_OK;
+	});
+	addMethod<EmptyMessage, IntMessage>({}, "CoreSuspend", [this](auto &, auto &out) {
+		if (_suspend_count++ == 0)
+			if (auto err = _process.stop())
+				qWarning() << "Failed to stop process" << err.message();
+		++_current_connection->suspend_count;
+		out.set_value(_suspend_count);
+		return CR_OK;
+	});
+	addMethod<EmptyMessage, IntMessage>({}, "CoreResume", [this](auto &, auto &out) {
+		if (_current_connection->suspend_count == 0)
+			return CR_FAILURE;
+		--_current_connection->suspend_count;
+		if (--_suspend_count == 0)
+			if (auto err = _process.cont())
+				qWarning() << "Failed to resume process" << err.message();
+		out.set_value(_suspend_count);
+		return CR_OK;
+	});
+
+	// llmemreader
+	addMethod<EmptyMessage, llmemoryreader::Info>("llmemreader", "GetInfo", [this](auto &, auto &out) {
+		auto id = _process.id();
+		if (id.size() == sizeof(uint32_t)) {
+			std::vector<uint8_t> pe(id.rbegin(), id.rend());
+			uint32_t value;
+			std::memcpy(&value, pe.data(), sizeof(value));
+			out.set_pe(value);
+		}
+		else {
+			std::string md5;
+			for (auto byte: id)
+				md5 += std::format("{:02x}", byte);
+			out.set_md5(md5);
+		}
+		out.set_base_offset(_process.base_offset());
+		return CR_OK;
+	});
+	addMethod<llmemoryreader::ReadRawIn, llmemoryreader::ReadRawOut>("llmemreader", "ReadRaw", [this](auto &in, auto &out) {
+		if (in.length() > MaxReadLength) {
+			out.set_error_message("Read is too large");
+			return CR_OK;
+		}
+		std::vector<uint8_t> data(in.length());
+		dfs::MemoryBufferRef buffer = {in.address(), data};
+		if (auto err = read({&buffer, 1}))
+			out.set_error_message(err.message());
+		else
+			out.set_data(data.data(), data.size());
+		return CR_OK;
+	});
+	addMethod<llmemoryreader::ReadRawVIn, llmemoryreader::ReadRawVOut>("llmemreader", "ReadRawV", [this](auto &in, auto &out) {
+		std::size_t total = 0;
+		for (const auto &range: in.list())
+			total += range.length();
+		if (total > MaxReadLength)
+			return CR_WRONG_USAGE;
+		std::vector<std::vector<uint8_t>> data;
+		std::vector<dfs::MemoryBufferRef> buffers;
+		data.reserve(in.list_size());
+		buffers.reserve(in.list_size());
+		for (const auto &range: in.list()) {
+			auto &buffer = data.emplace_back(range.length());
+			buffers.push_back({range.address(), buffer});
+		}
+		readList(buffers, out, true);
+		return CR_OK;
+	});
+	if (shared_memory) {
+		addMethod<StringMessage, EmptyMessage>("llmemreader", "MapSharedMemory", [this](auto &in, auto &) {
+			if (auto err = mapSharedMemory(in.value())) {
+				qWarning() << "Failed to map shared memory" << err.message();
+				return CR_FAILURE;
+			}
+			qInfo() << "Mapped shared memory" << in.value() << _shared_memory.size();
+			return CR_OK;
+		});
+		addMethod<llmemoryreader::ReadRawVIn, llmemoryreader::ReadRawVOut>("llmemreader", "ReadRawVShared", [this](auto &in, auto &out) {
+			if (_shared_memory.empty() || in.list_size() == 0)
+				return CR_WRONG_USAGE;
+			// First item is the destination range in the shared memory
+			const auto &dest = in.list(0);
+			if (dest.address() > _shared_memory.size() || dest.length() > _shared_memory.size() - dest.address())
+				return CR_WRONG_USAGE;
+			auto data = _shared_memory.subspan(dest.address(), dest.length());
+			std::vector<dfs::MemoryBufferRef> buffers;
+			buffers.reserve(in.list_size()-1);
+			for (const auto &range: in.list() | std::views::drop(1)) {
+				if (range.length() > data.size())
+					return CR_WRONG_USAGE;
+				buffers.push_back({range.address(), data.first(range.length())});
+				data = data.subspan(range.length());
+			}
+			readList(buffers, out, false);
+			return CR_OK;
+		});
+	}
+
+	// workdetailtest
+	addMethod<EmptyMessage, workdetailtest::ProcessInfo>("workdetailtest", "GetProcessInfo", [](auto &, auto &out) {
+		out.set_pid(0);
+		out.set_cookie_address(0);
+		out.set_cookie_value(0);
+		return CR_OK;
+	});
+	addMethod<EmptyMessage, workdetailtest::GameState>("workdetailtest", "GetGameState", [this](auto &, auto &out) {
+		DwarfFortressReader reader({_factory, _process});
+		auto world = prepare(reader);
+		out.set_world_loaded(world);
+		out.set_map_loaded(world ? reader.loadGameData(false)->map_block_index : 0);
+		return CR_OK;
+	});
+	addMethod<EmptyMessage, StringMessage>("workdetailtest", "GetUnits", [this](auto &, auto &out) {
+		DwarfFortressReader reader({_factory, _process});
+		if (!prepare(reader))
+			return CR_FAILURE;
+		auto data = reader.loadGameData();
+		out.set_value(DwarfFortressReader::writeUnitRecords(data->units));
+		return CR_OK;
+	});
+}
+
+MockServer::~MockServer()
+{
+	unmapSharedMemory();
+}
+
+bool MockServer::listen(quint16 port)
+{
+	return _server.listen(QHostAddress::LocalHost, port);
+}
+
+void MockServer::onNewConnection()
+{
+	while (auto socket = _server.nextPendingConnection()) {
+		qInfo() << "New connection from" << socket->peerAddress() << socket->peerPort();
+		auto connection = std::make_shared<connection_t>();
+		QObject::connect(socket, &QTcpSocket::readyRead, socket, [this, socket, connection]() {
+			connection->buffer.append(socket->readAll());
+			if (!processMessages(socket, *connection))
+				socket->disconnectFromHost();
+		});
+		QObject::connect(socket, &QTcpSocket::disconnected, socket, [this, socket, connection]() {
+			qInfo() << "Connection closed";
+			// Release suspends held by the closed connection
+			if (connection->suspend_count > 0) {
+				_suspend_count -= connection->suspend_count;
+				if (_suspend_count == 0)
+					if (auto err = _process.cont())
+						qWarning() << "Failed to resume process" << err.message();
+			}
+			socket->deleteLater();
+		});
+	}
+}
+
+bool MockServer::processMessages(QTcpSocket *socket, connection_t &connection)
+{
+	auto &buffer = connection.buffer;
+	if (!connection.handshake_done) {
+		if (std::size_t(buffer.size()) < RequestMagic.size() + sizeof(int32_t))
+			return true;
+		int32_t version;
+		std::memcpy(&version, buffer.data() + RequestMagic.size(), sizeof(version));
+		if (!buffer.startsWith(QByteArrayView(RequestMagic.data(), RequestMagic.size())) || version != ProtocolVersion) {
+			qWarning() << "Invalid handshake";
+			return false;
+		}
+		buffer.remove(0, RequestMagic.size() + sizeof(int32_t));
+		QByteArray reply(ResponseMagic.data(), ResponseMagic.size());
+		reply.append(reinterpret_cast<const char *>(&ProtocolVersion), sizeof(ProtocolVersion));
+		send(socket, std::move(reply));
+		connection.handshake_done = true;
+	}
+	while (std::size_t(buffer.size()) >= sizeof(RPCMessageHeader)) {
+		RPCMessageHeader header;
+		std::memcpy(&header, buffer.data(), sizeof(header));
+		if (header.id == RPC_REQUEST_QUIT)
+			return false;
+		if (header.size < 0)
+			return false;
+		if (std::size_t(buffer.size()) < sizeof(header) + header.size)
+			return true;
+		std::string_view data(buffer.data() + sizeof(header), header.size);
+		std::string out;
+		int32_t cr;
+		if (header.id == RPC_BIND_METHOD) {
+			dfproto::CoreBindRequest request;
+			dfproto::CoreBindReply reply;
+			if (!request.ParseFromArray(data.data(), data.size()))
+				cr = CR_WRONG_USAGE;
+			else if ((cr = bindMethod(request, reply)) == CR_OK)
+				reply.SerializeToString(&out);
+		}
+		else if (header.id >= FirstMethodId && std::size_t(header.id - FirstMethodId) < _methods.size()) {
+			_current_connection = &connection;
+			cr = _methods[header.id - FirstMethodId].call(data, out);
+			_current_connection = nullptr;
+		}
+		else {
+			cr = CR_NOT_IMPLEMENTED;
+		}
+		sendResult(socket, cr, out);
+		buffer.remove(0, sizeof(header) + header.size);
+	}
+	return true;
+}
+
+int32_t MockServer::bindMethod(const dfproto::CoreBindRequest &request, dfproto::CoreBindReply &reply)
+{
+	auto it = std::ranges::find_if(_methods, [&](const auto &method) {
+		return method.plugin == request.plugin() && method.name == request.method();
+	});
+	if (it == _methods.end()) {
+		qWarning() << "Unknown method"
+			<< QString::fromStdString(request.plugin())
+			<< QString::fromStdString(request.method());
+		return CR_FAILURE;
+	}
+	if (it->input != request.input_msg() || it->output != request.output_msg()) {
+		qWarning() << "Invalid message types for"
+			<< QString::fromStdString(request.method());
+		return CR_FAILURE;
+	}
+	reply.set_assigned_id(FirstMethodId + std::distance(_methods.begin(), it));
+	return CR_OK;
+}
+
+void MockServer::send(QTcpSocket *socket, QByteArray data)
+{
+	if (_latency.count() > 0)
+		QTimer::singleShot(_latency, socket, [socket, data = std::move(data)]() {
+			socket->write(data);
+		});
+	else
+		socket->write(data);
+}
+
+void MockServer::sendResult(QTcpSocket *socket, int32_t cr, const std::string &data)
+{
+	RPCMessageHeader header = {
+		cr == CR_OK ? RPC_REPLY_RESULT : RPC_REPLY_FAIL,
+		0,
+		cr == CR_OK ? int32_t(data.size()) : cr
+	};
+	QByteArray message(reinterpret_cast<const char *>(&header), sizeof(header));
+	if (cr == CR_OK)
+		message.append(data.data(), data.size());
+	send(socket, std::move(message));
+}
+
+std::error_code MockServer::read(std::span<const dfs::MemoryBufferRef> buffers)
+{
+	std::error_code err;
+	_process.sync(readv(_process, buffers, err));
+	return err;
+}
+
+void MockServer::readList(std::span<const dfs::MemoryBufferRef> buffers,
+		dfproto::llmemoryreader::ReadRawVOut &out,
+		bool copy_data)
+{
+	auto failed = bool(read(buffers));
+	for (const auto &buffer: buffers) {
+		auto result = out.add_list();
+		// Find which ranges failed
+		if (failed) {
+			if (auto err = read({&buffer, 1})) {
+				result->set_error_message(err.message());
+				continue;
+			}
+		}
+		if (copy_data)
+			result->set_data(buffer.data.data(), buffer.data.size());
+	}
+}
+
+#ifdef Q_OS_UNIX
+std::error_code MockServer::mapSharedMemory(const std::string &name)
+{
+	unmapSharedMemory();
+	int fd = shm_open(name.c_str(), O_RDWR, 0);
+	if (fd == -1)
+		return std::error_code(errno, std::system_category());
+	struct stat st;
+	if (fstat(fd, &st) == -1) {
+		auto err = errno;
+		close(fd);
+		return std::error_code(err, std::system_category());
+	}
+	auto addr = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	auto err = errno;
+	close(fd);
+	if (addr == MAP_FAILED)
+		return std::error_code(err, std::system_category());
+	_shared_memory = {static_cast<uint8_t *>(addr), std::size_t(st.st_size)};
+	return {};
+}
+
+void MockServer::unmapSharedMemory()
+{
+	if (!_shared_memory.empty())
+		munmap(_shared_memory.data(), _shared_memory.size());
+	_shared_memory = {};
+}
+#else
+std::error_code MockServer::mapSharedMemory(const std::string &)
+{
+	return std::make_error_code(std::errc::not_supported);
+}
+
+void MockServer::unmapSharedMemory()
+{
+}
+#endif
+
+uintptr_t MockServer::prepare(DwarfFortressReader &reader)
+{
+	reader.session.addSharedObjectsCache<df::itemdef>(_raws_cache);
+	auto world = reader.getWorldDataPtr();
+	if (world != _world) {
+		_raws_cache.clear();
+		_raws = world ? reader.loadRaws() : nullptr;
+		_world = world;
+	}
+	return world;
+}
+
+int main(int argc, char *argv[]) try
+{
+	QCoreApplication app(argc, argv);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Mock DFHack server for workdetailtest");
+	parser.addHelpOption();
+	QCommandLineOption port_option("port", "Listen on <port> (default: 5000).", "port", "5000");
+	QCommandLineOption latency_option("latency", "Delay each reply by <ms> milliseconds.", "ms", "0");
+	QCommandLineOption structures_option("structures", "Load structures from <dir>.", "dir");
+	QCommandLineOption no_shared_memory_option("no-shared-memory", "Do not implement the shared memory functions.");
+#ifndef Q_OS_WIN
+	QCommandLineOption wine_option("wine", "The DF process is the Windows version running in wine.");
+	parser.addOption(wine_option);
+#endif
+	parser.addOptions({port_option, latency_option, structures_option, no_shared_memory_option});
+	parser.addPositionalArgument("pid", "DF process id");
+	parser.process(app);
+
+	if (parser.positionalArguments().size() != 1 || !parser.isSet(structures_option))
+		parser.showHelp(1);
+
+	auto pid = parser.positionalArguments()[0].toInt();
+#ifdef Q_OS_WIN
+	auto process = std::make_unique<dfs::Win32Process>(pid);
+#else
+	std::unique_ptr<dfs::Process> process;
+	if (parser.isSet(wine_option))
+		process = std::make_unique<dfs::WineProcess>(pid);
+	else
+		process = std::make_unique<dfs::LinuxProcess>(pid);
+#endif
+
+	dfs::Structures structures(
+			std::filesystem::path(parser.value(structures_option).toStdString()),
+			[](std::string_view msg) { qWarning() << msg; });
+	const auto &versions = structures.allVersions();
+	auto version = std::ranges::find_if(versions, [&](const auto &version) {
+		return std::ranges::equal(version.id, process->id());
+	});
+	if (version == versions.end()) {
+		qCritical() << "Unsupported DF version";
+		return -1;
+	}
+	qInfo() << "DF version" << version->version_name;
+	dfs::ReaderFactory factory(structures, *version);
+
+	MockServer server(*process, factory,
+			std::chrono::milliseconds(parser.value(latency_option).toInt()),
+			!parser.isSet(no_shared_memory_option));
+	auto port = parser.value(port_option).toUShort();
+	if (!server.listen(port)) {
+		qCritical() << "Failed to listen on port" << port;
+		return -1;
+	}
+	qInfo() << "Listening on port" << port;
+	return app.exec();
+}
+catch (std::exception &e)
+{
+	qCritical() << e.what();
+	return -1;
+}
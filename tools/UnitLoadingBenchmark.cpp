@@ -0,0 +1,170 @@
+/*
+ * Copyright 2024 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+// Compare loading game data through DFHack memory reads and through the
+// GetUnits unit records. Use with a DFHack server or MockDFHackServer
+// (with --latency to simulate a slower connection, and --no-shared-memory
+// to read memory through the socket).
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QtConcurrent>
+#include <QCoroFuture>
+#include <QCoroTask>
+
+#include <dfhack-client-qt/Client.h>
+#include <dfhack-client-qt/Function.h>
+
+#include <dfs/Structures.h>
+#include <dfs/Reader.h>
+
+#include "DFHackProcess.h"
+#include "DwarfFortressReader.h"
+#include "df/types.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <numeric>
+
+static const DFHack::Function<
+	dfproto::EmptyMessage,
+	dfproto::StringMessage
+> GetUnits = {"workdetailtest", "GetUnits"};
+
+struct timings_t
+{
+	std::vector<qint64> times;
+	std::size_t unit_count = 0;
+
+	void print(std::string_view name) const {
+		if (times.empty())
+			return;
+		auto [min, max] = std::ranges::minmax(times);
+		auto total = std::accumulate(times.begin(), times.end(), qint64(0));
+		std::cout << std::format("{}: {} units, min {} ms, avg {} ms, max {} ms\n",
+				name, unit_count, min, total / qint64(times.size()), max);
+	}
+};
+
+static QCoro::Task<int> run(const QString &host, quint16 port,
+		int connection_count, int iterations,
+		const std::filesystem::path &structures_path)
+{
+	std::vector<std::unique_ptr<DFHack::Client>> clients;
+	std::vector<DFHack::Client *> client_ptrs;
+	for (int i = 0; i < connection_count; ++i) {
+		auto client = std::make_unique<DFHack::Client>();
+		if (!co_await client->connect(host, port)) {
+			std::cerr << "Failed to connect to " << host.toStdString() << ":" << port << "\n";
+			co_return -1;
+		}
+		client_ptrs.push_back(client.get());
+		clients.push_back(std::move(client));
+	}
+	co_return co_await QtConcurrent::run([&]() {
+		try {
+			dfs::Structures structures(structures_path,
+					[](std::string_view msg) { std::cerr << msg << "\n"; });
+			auto process = std::make_unique<DFHackProcess>(client_ptrs);
+			const auto &versions = structures.allVersions();
+			auto version = std::ranges::find_if(versions, [&](const auto &version) {
+				return std::ranges::equal(version.id, process->id());
+			});
+			if (version == versions.end()) {
+				std::cerr << "Unsupported DF version\n";
+				return -1;
+			}
+			// Same settings as DwarfFortress
+			dfs::ProcessVectorizer vectorizer(std::move(process), 48*1024*1024);
+			dfs::ReaderFactory factory(structures, *version);
+			dfs::ReadSession::shared_objects_cache_t raws_cache;
+			std::unique_ptr<df::world_raws> raws;
+			{
+				DwarfFortressReader reader({factory, vectorizer});
+				reader.session.addSharedObjectsCache<df::itemdef>(raws_cache);
+				if (reader.getWorldDataPtr() == 0) {
+					std::cerr << "No world loaded\n";
+					return -1;
+				}
+				raws = reader.loadRaws();
+			}
+
+			timings_t memory, records;
+			for (int i = 0; i < iterations; ++i) {
+				QElapsedTimer timer;
+				DwarfFortressReader reader({factory, vectorizer});
+				reader.session.addSharedObjectsCache<df::itemdef>(raws_cache);
+
+				timer.start();
+				auto data = reader.loadGameData();
+				memory.times.push_back(timer.elapsed());
+				memory.unit_count = data->units.size();
+
+				timer.start();
+				auto [reply, notifications] = GetUnits(*client_ptrs.front());
+				reply.waitForFinished();
+				auto r = reply.result();
+				if (!r) {
+					std::cerr << "GetUnits failed: " << make_error_code(r.cr).message() << "\n";
+					return -1;
+				}
+				auto units = DwarfFortressReader::parseUnitRecords(r->value());
+				data = reader.loadGameData(false);
+				data->units = std::move(units);
+				records.times.push_back(timer.elapsed());
+				records.unit_count = data->units.size();
+			}
+			memory.print("memory reads");
+			records.print("unit records");
+			return 0;
+		}
+		catch (std::exception &e) {
+			std::cerr << e.what() << "\n";
+			return -1;
+		}
+	});
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Benchmark unit loading through DFHack");
+	parser.addHelpOption();
+	QCommandLineOption host_option("host", "Connect to <host> (default: localhost).", "host", "localhost");
+	QCommandLineOption port_option("port", "Connect to <port> (default: 5000).", "port", "5000");
+	QCommandLineOption connections_option("connections", "Read memory using <n> connections (default: 1).", "n", "1");
+	QCommandLineOption iterations_option("iterations", "Load game data <n> times (default: 5).", "n", "5");
+	QCommandLineOption structures_option("structures", "Load structures from <dir>.", "dir");
+	parser.addOptions({host_option, port_option, connections_option, iterations_option, structures_option});
+	parser.process(app);
+
+	if (!parser.isSet(structures_option))
+		parser.showHelp(1);
+
+	return QCoro::waitFor(run(parser.value(host_option),
+			parser.value(port_option).toUShort(),
+			std::max(1, parser.value(connections_option).toInt()),
+			std::max(1, parser.value(iterations_option).toInt()),
+			parser.value(structures_option).toStdString()));
+}